@@ -0,0 +1,34 @@
+// board description for eridien P3, pins.h is generated from this
+//   node pins_calc-C.js board-p3.js
+// one firmware build runs on every mcu of the board, the id pin picks
+// which mcu it is (and its i2c addrs) at startup
+
+module.exports = {
+  name: 'eridien P3',
+  part: 'PIC24F16KM202',
+
+  // 7-bit i2c addr of motor A on each mcu, the rest follow in order
+  // the id pin is read once before it is set as an output
+  idPin: 'RB1',
+  mcus: [
+    {name: 'mcuA', addr: 0x04},   // id pin 0
+    {name: 'mcuB', addr: 0x08},   // id pin 1
+  ],
+
+  // drv8825 lines shared by all motors, set just before each step
+  dirPin: 'RA6',
+  ms1Pin: 'RA7',
+  ms2Pin: 'RB7',
+
+  // one entry per motor, named A, B, ... in order
+  // limCN is the change notice number of the lim pin
+  // encA/encB (and their CN numbers) are an optional quadrature encoder,
+  // only read when the encoder settings are not zero
+  motors: [
+    {step: 'RB1', reset: 'RB15', fault: 'RA3', lim: 'RA0', limCN: 2,
+     encA: 'RB10', encACN: 16, encB: 'RB11', encBCN: 15},
+    {step: 'RB2', reset: 'RB14', fault: 'RB4', lim: 'RB0', limCN: 4},
+    {step: 'RB3', reset: 'RB13', fault: 'RA4', lim: 'RB6', limCN: 24},
+    {step: 'RA2', reset: 'RB12', fault: 'RB5', lim: 'RA1', limCN: 3},
+  ],
+};
@@ -4,6 +4,7 @@
 #include "clock.h"
 #include "pins.h"
 #include "motor.h"
+#include "state.h"
 /*
  * 3 => 14.6 usecs
  * 4 => 14.6
@@ -27,5 +28,99 @@ void clkInit(void) {
 }
 
 volatile uint16 timeTicks;     // units: 20 usecs, wraps on 1.31 secs
+volatile uint16 timeTicksHi;   // with timeTicks wraps in over a day
+uint32          syncOfs;       // set by general call sync, see sync.c
 
 // clock interrupt routine is in motor.c
+
+volatile uint8  clkTicksPerInt = 1;
+bool            clkLowPowerOn;
+uint16          clkNormalPR;
+volatile bool   clkIdling;
+volatile bool   wakeStarted;
+volatile uint16 wakeStartTicks;
+volatile uint16 wakeStartTmr;
+volatile uint16 wakeLatencyMax;
+
+// 32-bit time including ticks a slow timer int hasn't added yet
+// from interrupt or with ints disabled
+uint32 extTicksNowInt() {
+  uint32 t = extTicksInt();
+  if(clkLowPowerOn) {
+    if(_T1IF) t += clkTicksPerInt;   // slow period ended, int not run yet
+    t += TMR1 / (clkNormalPR + 1);
+  }
+  return t;
+}
+
+// time shared by all mcus on the bus after a sync, from event loop
+uint32 syncTicks() {
+  disableAllInts;
+  uint32 t = syncTicksInt();
+  enableAllInts;
+  return t;
+}
+
+// from i2c interrupt when command received
+// also while going idle, a command then may wait for the first slow int
+void clkWakeStart() {
+  if((clkLowPowerOn || clkIdling) && !wakeStarted) {
+    uint16 period  = (clkLowPowerOn ? clkNormalPR : PR1) + 1;
+    wakeStartTicks = (uint16) extTicksNowInt();
+    wakeStartTmr   = TMR1 % period;
+    wakeStarted    = true;
+  }
+}
+
+// ticks counted in TMR1 since last timer int go into timeTicks
+// the rest stays in TMR1, so time isn't lost when PR1 changes
+// with ints disabled
+void clkTmrToTicks() {
+  uint16 tmr   = TMR1;
+  uint16 ticks = tmr / (clkNormalPR + 1);
+  if(ticks) {
+    TMR1       = tmr - ticks * (clkNormalPR + 1);
+    timeTicks += ticks;
+    if (timeTicks < ticks) timeTicksHi++;
+  }
+}
+
+// from event loop when all motors are idle (on) or first sees work (off)
+void clkLowPower(bool on) {
+  disableAllInts;
+  // a pending timer int would add ticks at the new rate, switch next pass
+  if(on && !clkLowPowerOn && !_T1IF) {
+    uint8 ticksPerInt = IDLE_TICKS_PER_INT;
+    clkNormalPR = PR1;
+    while((uint32) (clkNormalPR + 1) * ticksPerInt > 0x10000) {
+      ticksPerInt >>= 1;
+    }
+    // TMR1 is part way to the next tick, keep it
+    PR1            = (clkNormalPR + 1) * ticksPerInt - 1;
+    clkTicksPerInt = ticksPerInt;
+    clkLowPowerOn  = true;
+  }
+  else if(!on && clkLowPowerOn) {
+    if(wakeStarted) {
+      // timer counts since command was received, in normal ticks
+      uint16 ticks  = (uint16) extTicksNowInt() - wakeStartTicks;
+      uint32 counts = (uint32) ticks * (clkNormalPR + 1) + 
+                      TMR1 % (clkNormalPR + 1) - wakeStartTmr;
+      uint16 usecs  = counts / TMR_COUNTS_PER_USEC;
+      if(usecs > wakeLatencyMax) wakeLatencyMax = usecs;
+      wakeStarted = false;
+    }
+    if(_T1IF) {
+      // slow period ended, pending int adds only 1 of its ticks
+      timeTicks += clkTicksPerInt - 1;
+      if (timeTicks < clkTicksPerInt - 1) timeTicksHi++;
+    }
+    else {
+      clkTmrToTicks();
+    }
+    PR1            = clkNormalPR;
+    clkTicksPerInt = 1;
+    clkLowPowerOn  = false;
+  }
+  enableAllInts;
+}
@@ -8,8 +8,30 @@
 
 #define setTicksSec() (PR1 = (16*mSet[0].val.mcuClock)-1)
 extern volatile uint16 timeTicks; 
+extern volatile uint16 timeTicksHi;  // counts timeTicks wraps, 32-bit time
+extern          uint32 syncOfs;      // 32-bit time + syncOfs = time shared by mcus
 extern          uint16 clkTicksPerSec;
+
+// low power, timer interrupt is slower and each adds many ticks
+#define IDLE_TICKS_PER_INT 32
+#define TMR_COUNTS_PER_USEC 16
+extern volatile uint8  clkTicksPerInt;
+extern          bool   clkLowPowerOn;
+extern volatile bool   clkIdling;      // event loop is going idle
+extern volatile uint16 wakeLatencyMax; // usecs, cmd recvd to event loop
+extern volatile bool   wakeStarted;    // cmd recvd, latency not measured yet
+
+// from interrupt or with ints disabled
+#define extTicksInt()  (((uint32) timeTicksHi << 16) | timeTicks)
+// with ticks counted in TMR1 but not yet added by a slow (low power) int
+// for times latched from the bus, which must match across mcus
+#define syncTicksInt() (extTicksNowInt() + syncOfs)
+
 void clkInit(void);
+uint32 extTicksNowInt(void);
+uint32 syncTicks(void);
+void clkLowPower(bool on);
+void clkWakeStart(void);
 
 #endif	/* CLOCK_H */
 
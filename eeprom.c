@@ -0,0 +1,140 @@
+
+#include <xc.h>
+#include "types.h"
+#include "eeprom.h"
+#include "motor.h"
+#include "state.h"
+
+uint16 __attribute__((space(eedata))) eeSettings[NUM_MOTORS][EE_BLOCK_WORDS];
+
+volatile uint8 eeSaveMask;
+volatile uint8 eeClearMask;
+volatile uint8 eeWriteMask;
+
+uint8  eeMotIdx;
+int8   eeWordIdx = -1; // next word to write, -1 when idle
+bool   eeClearing;     // block being cleared, not saved
+uint16 eeCrcSum;       // crc of version and settings words written so far
+
+// crc of block starts with 0xffff, version word is first
+uint16 eeCrc(uint16 crc, uint16 word) {
+  uint8 bit;
+  crc ^= word;
+  for(bit = 0; bit < 16; bit++) {
+    crc = ((crc & 1) ? ((crc >> 1) ^ 0xa001) : (crc >> 1));
+  }
+  return crc;
+}
+
+// crc a block saved from the motor's settings now would have
+uint16 eeSettingsCrc(uint8 motIdx) {
+  uint16 crc = eeCrc(0xffff, EE_SETTINGS_VERSION);
+  uint8 i;
+  for(i = 0; i < NUM_SETTING_WORDS; i++) {
+    crc = eeCrc(crc, mSet[motIdx].reg[i]);
+  }
+  return crc;
+}
+
+uint16 eeRead(uint16 *addr) {
+  TBLPAG = __builtin_tblpage(addr);
+  return __builtin_tblrdl(__builtin_tbloffset(addr));
+}
+
+// starts erase+write of one word, takes a few ms
+// caller checks NVMCONbits.WR for done
+void eeWrite(uint16 *addr, uint16 val) {
+  NVMCON = 0x4004;  // word erase and write
+  TBLPAG = __builtin_tblpage(addr);
+  __builtin_tblwtl(__builtin_tbloffset(addr), val);
+  __builtin_disi(5);
+  __builtin_write_NVM();
+}
+
+// from motorInit, returns true if valid settings loaded into mSet
+// block is read twice, to check it and to copy it, so no ram buffer
+bool eeLoadSettings(uint8 motIdx) {
+  uint16 *blk = eeSettings[motIdx];
+  uint16 crc  = 0xffff;
+  uint8 i;
+  for(i = 0; i < EE_BLOCK_WORDS-1; i++) {
+    crc = eeCrc(crc, eeRead(&blk[i]));
+  }
+  if(eeRead(&blk[0]) != EE_SETTINGS_VERSION ||
+     eeRead(&blk[EE_BLOCK_WORDS-1]) != crc) {
+    return false;
+  }
+  for(i = 0; i < NUM_SETTING_WORDS; i++) {
+    mSet[motIdx].reg[i] = eeRead(&blk[i+1]);
+  }
+  return true;
+}
+
+// save (or clear) is done a word at a time from event loop
+// the last of a save and clear not started yet is the one done
+void eeSaveCommand(bool clear) {
+  uint8 motBit = (1 << motorIdx);
+  disableAllInts;
+  if(clear) {
+    eeClearMask |=  motBit;
+    eeSaveMask  &= ~motBit;
+  }
+  else {
+    eeSaveMask  |=  motBit;
+    eeClearMask &= ~motBit;
+  }
+  enableAllInts;
+}
+
+// from event loop, never waits for eeprom
+void chkEeprom() {
+  if(NVMCONbits.WR) return;  // last word still being written
+  if(eeWordIdx < 0) {
+    // last word of block is written
+    eeWriteMask = 0;
+    uint8 motBit;
+    for(eeMotIdx = 0; eeMotIdx < NUM_MOTORS; eeMotIdx++) {
+      motBit = (1 << eeMotIdx);
+      if((eeSaveMask | eeClearMask) & motBit) break;
+    }
+    if(eeMotIdx == NUM_MOTORS) {
+      // nothing to write
+      return;
+    }
+    // request is taken now, one arriving while block is written
+    // sets its bit again and is done after
+    disableAllInts;
+    bool clear = ((eeClearMask & motBit) != 0);
+    eeSaveMask  &= ~motBit;
+    eeClearMask &= ~motBit;
+    eeWriteMask  =  motBit;
+    enableAllInts;
+    // bad version is enough to ignore block, a clear only writes that
+    eeClearing = clear;
+    eeWordIdx  = (clear ? 0 : 1);
+    eeCrcSum   = eeCrc(0xffff, EE_SETTINGS_VERSION);
+  }
+  uint16 *addr = &eeSettings[eeMotIdx][eeWordIdx];
+  if(eeWordIdx == 0) {
+    // version word is written last
+    eeWrite(addr, (eeClearing ? 0 : EE_SETTINGS_VERSION));
+    eeWordIdx = -1;
+  }
+  else if(eeWordIdx == EE_BLOCK_WORDS-1) {
+    if(eeCrcSum != eeSettingsCrc(eeMotIdx)) {
+      // settings changed while written, start over so block is one snapshot
+      eeWordIdx = 1;
+      eeCrcSum  = eeCrc(0xffff, EE_SETTINGS_VERSION);
+      return;
+    }
+    eeWrite(addr, eeCrcSum);
+    eeWordIdx = 0;
+  }
+  else {
+    // settings words are written straight from mSet
+    uint16 val = mSet[eeMotIdx].reg[eeWordIdx-1];
+    eeCrcSum   = eeCrc(eeCrcSum, val);
+    eeWrite(addr, val);
+    eeWordIdx++;
+  }
+}
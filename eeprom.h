@@ -0,0 +1,26 @@
+
+#ifndef EEPROM_H
+#define	EEPROM_H
+
+#include <xc.h>
+#include "types.h"
+#include "motor.h"
+
+// one block per motor in data eeprom: version, settings words, crc
+// version changes when settings struct changes so old blocks are ignored
+#define EE_SETTINGS_VERSION (0x5e00 | NUM_SETTING_WORDS)
+#define EE_BLOCK_WORDS      (NUM_SETTING_WORDS + 2)
+
+extern volatile uint8 eeSaveMask;  // motors waiting for save to start
+extern volatile uint8 eeClearMask; // motors waiting for clear to start
+extern volatile uint8 eeWriteMask; // motor whose block is being written
+
+// save or clear of motor not finished yet
+#define eeBusyMask() (eeSaveMask | eeClearMask | eeWriteMask)
+
+bool eeLoadSettings(uint8 motIdx);
+void eeSaveCommand(bool clear);
+void chkEeprom(void);
+
+#endif	/* EEPROM_H */
+
@@ -0,0 +1,71 @@
+
+#include <xc.h>
+#include "types.h"
+#include "pins.h"
+#include "encoder.h"
+#include "state.h"
+#include "motor.h"
+
+// gray code order is 00 01 11 10, a skipped state (both changed) counts 0
+const int8 quadStep[16] = { 0,  1, -1,  0,
+                           -1,  0,  0,  1,
+                            1,  0,  0, -1,
+                            0, -1,  1,  0};
+
+// encoder pins are inputs, their interrupts are off until settings enable them
+void encoderInit() {
+#define encPinInit(_m, _idx) enc##_m##ATRIS = 1; enc##_m##BTRIS = 1;
+  forEachEnc(encPinInit)
+}
+
+// encRatio setting changed
+void applyEncSetting() {
+  ms->haveEnc = (sv->encRatio != 0 && (ENC_MOTOR_MASK & (1 << motorIdx)));
+#define encIntEnable(_m, _idx)                                     \
+  if(motorIdx == _idx) {                                           \
+    enc##_m##ACNIE = ms->haveEnc;                                  \
+    enc##_m##BCNIE = ms->haveEnc;                                  \
+    ms->encLast    = ((enc##_m##APORT & enc##_m##ABIT) ? 2 : 0) |  \
+                     ((enc##_m##BPORT & enc##_m##BBIT) ? 1 : 0);   \
+  }
+  disableAllInts;
+  forEachEnc(encIntEnable)
+  enableAllInts;
+  encResync();
+}
+
+// encoder count 0 is motor at output pos now
+void encResync() {
+  int16 pos = outputPos();
+  disableAllInts;
+  ms->encCount  = 0;
+  ms->encRefPos = pos;
+  enableAllInts;
+}
+
+// motor pos from encoder, in 1/8 steps
+// from interrupt or with interrupts disabled
+int16 encoderPosInt(uint8 motIdx) {
+  struct motorState *p = &mState[motIdx];
+  return p->encRefPos +
+         (int16) ((p->encCount * mSet[motIdx].val.encRatio) >> 8);
+}
+
+// from event loop, stalled or slipping motor is caught on its next step
+void chkFollowing() {
+  if(!ms->haveEnc) return;
+  if((ms->stateByte & BUSY_BIT) == 0) {
+    // idle motor is where it is, next move follows from here
+    encResync();
+    return;
+  }
+  int16 pos = outputPos();
+  disableAllInts;
+  int16 err = pos - encoderPosInt(motorIdx);
+  enableAllInts;
+  uint16 absErr = (err < 0 ? -err : err);
+  if(absErr > ms->encErrMax) ms->encErrMax = absErr;
+  if(sv->encMaxErr && absErr > sv->encMaxErr) {
+    setError(FOLLOWING_ERROR);
+  }
+}
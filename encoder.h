@@ -0,0 +1,31 @@
+#ifndef ENCODER_H
+#define	ENCODER_H
+
+#include <xc.h>
+#include "types.h"
+#include "pins.h"
+#include "motor.h"
+#include "state.h"
+
+// optional quadrature encoder per motor, pins from the board file
+// following error is steps output less motor pos from encoder
+
+// count change from last and new AB levels, idx is (last << 2) | new
+extern const int8 quadStep[16];
+
+// from change notice interrupt, for each motor with encoder pins
+#define encDecode(_m, _idx) {                                      \
+    struct motorState *e = &mState[_idx];                          \
+    uint8 ab = ((enc##_m##APORT & enc##_m##ABIT) ? 2 : 0) |        \
+               ((enc##_m##BPORT & enc##_m##BBIT) ? 1 : 0);         \
+    e->encCount += quadStep[(e->encLast << 2) | ab];               \
+    e->encLast   = ab;                                             \
+  }
+
+void  encoderInit(void);
+void  applyEncSetting(void);
+void  encResync(void);
+int16 encoderPosInt(uint8 motIdx);
+void  chkFollowing(void);
+
+#endif	/* ENCODER_H */
@@ -8,9 +8,39 @@
 #include "stop.h"
 #include "move.h"
 #include "clock.h"
+#include "sync.h"
+
+// steps lost since last home move the switch edge in curPos
+// last home put the edge at homePos - homeOfs
+void homeDrift(int16 edgePos) {
+  int16  drift    = edgePos - (sv->homePos - sv->homeOfs);
+  uint16 absDrift = (drift < 0 ? -drift : drift);
+  ms->driftLast = drift;
+  if(absDrift > ms->driftMax) ms->driftMax = absDrift;
+  if(ms->driftHomes < 255) ms->driftHomes++;
+  if(absDrift > sv->driftTol && ms->driftOverTol < 255) ms->driftOverTol++;
+}
 
 void chkHoming() {
   switch(ms->homingState) {
+    case homeFastSeek:
+      if(limitSwOn()) {
+        // hit switch at speed, overshoot while slowing and then back off
+        ms->targetDir   = !sv->homingDir;
+        ms->targetSpeed = sv->homingBackUpSpeed;
+        ms->homingState = homeRetract;
+      }
+      break;
+
+    case homeRetract:
+      if(ms->curDir == ms->targetDir && !limitSwOn()) {
+        // backed off switch, re-approach slowly for precise position
+        ms->targetDir   = sv->homingDir;
+        ms->targetSpeed = sv->homingSpeed;
+        ms->homingState = goingHome;
+      }
+      break;
+
     case movingToFwdSide:
       if(!limitSwOn()) {
         // start normal homing
@@ -23,6 +53,8 @@ void chkHoming() {
       if(limitSwOn()) {
         // arrived at switch while homing backward
         // HOMED_BIT not cleared until now, homing might have been interrupted
+        // curPos not from a finished home can't measure drift
+        if((ms->stateByte & HOMED_BIT) == 0) ms->homeDriftValid = false;
         setStateBit(HOMED_BIT, false);
         ms->targetDir   = !sv->homingDir;
         ms->targetSpeed = sv->homingBackUpSpeed;
@@ -33,36 +65,57 @@ void chkHoming() {
     case homeReversing:
       if(!limitSwOn()) {
         // passed switch second (or third) time
-        ms->homeTestPos = ms->curPos;
-        ms->curPos      = 0;
+        // use pos latched at switch edge, curPos may be past it
+        // with activity check the edge is now, at the last step output
+        bool  actChk    = ((sv->limitSwCtl & LIM_ACT_TIMEOUT_MASK) != 0);
+        int16 edgePos   = (actChk ? outputPos() : ms->limEdgePos);
+        ms->homeTestPos = edgePos;
+        if(ms->homeDriftValid) homeDrift(edgePos);
+        ms->curPos     -= edgePos;
+        ms->encRefPos  -= edgePos;   // encoder follows the new pos
         ms->homingState = homingToOfs;
        }
       break;
     
-    case homingToOfs: 
-      if(sv->homingDir ? (ms->curPos <= sv->homeOfs) 
-                       : (ms->curPos >= sv->homeOfs)) {
+    case homingToOfs: {
+      // stop where the motor is, not where planning is, so home
+      // doesn't move with the number of steps planned ahead
+      int16 pos = outputPos();
+      if(sv->homingDir ? (pos <= sv->homeOfs) 
+                       : (pos >= sv->homeOfs)) {
         ms->homing = false;
         setStateBit(HOMED_BIT, 1);
-        ms->curPos = sv->homePos;
+        ms->homeDriftValid = true;
+        // drops any step not output yet, so set pos after
+        // homePos is at homeOfs from the edge, keep any overshoot past it
         stopStepping();
+        ms->encRefPos += sv->homePos - sv->homeOfs;
+        ms->curPos     = sv->homePos + (ms->curPos - sv->homeOfs);
         return;
       }
       break;
+    }
   }
 }
 void homeCommand(bool start) {
+  if(ss->segMode) stopStepping();
   ms->slowing = false;
+  // an armed probe would stop the home at the first switch edge
+  disableAllInts;
+  ms->probeState = PROBE_IDLE;
+  enableAllInts;
   if((ms->stateByte & BUSY_BIT) == 0) {
     // not moving -- init speed
     motorOn();
     disableAllInts;
-    ms->lastStepTicks = timeTicks;
+    ms->lastStepTicks = moveStartTicks();
     enableAllInts;
     ms->curSpeed = sv->jerk;
   }
-  if(start && ms->limitPort) {
-    ms->limitCountHi = ms->limitCountLo = 0;
+  if(start && ms->haveLimSw) {
+    disableAllInts;
+    ms->limEdgeTicks = timeTicks; // activity timeout starts now
+    enableAllInts;
     ms->homing = true;
     if(limitSwOn()) {
       // go to fwd side of switch at full homing speed
@@ -74,6 +127,11 @@ void homeCommand(bool start) {
       ms->targetDir   = sv->homingDir;
     }
     ms->targetSpeed = sv->homingSpeed;
+    if(ms->homingState == goingHome && sv->homingFastSpeed) {
+      // far from switch, first approach with full accel
+      ms->homingState = homeFastSeek;
+      ms->targetSpeed = sv->homingFastSpeed;
+    }
     setStateBit(BUSY_BIT,  1);
     // homed sState bit unchanged until we get to limit switch
     //   so homing can be interrupted by move command
@@ -83,7 +141,73 @@ void homeCommand(bool start) {
     // hard stop with no reset
     // set wherever it lands to home pos
     stopStepping();
-    ms->curPos = sv->homePos;
+    ms->curPos         = sv->homePos;
+    ms->homeDriftValid = false;    // no switch edge to measure next home from
     setStateBit(HOMED_BIT, 1);
   }
 }
+
+volatile uint8 homeAllGroups[NUM_MOTORS];
+volatile uint8 homeAllNumGroups;
+volatile uint8 homeAllGroupIdx;
+volatile uint8 homeAllStartMask;
+volatile uint8 homeAllBusyMask;
+
+void startHomeAllGroup() {
+  // home all status (i2c interrupt) sees the group as pending throughout
+  disableAllInts;
+  if(homeAllGroupIdx < homeAllNumGroups) {
+    uint8 mask = homeAllGroups[homeAllGroupIdx++];
+    homeAllStartMask = mask;
+    homeAllBusyMask  = mask;
+  }
+  enableAllInts;
+}
+
+void homeAllCommand(uint8 numGroups, volatile uint8 *groups) {
+  uint8 i;
+  for(i = 0; i < numGroups; i++) {
+    if(groups[i] == 0 || (groups[i] & ~((1 << NUM_MOTORS) - 1))) {
+      setError(CMD_DATA_ERROR);
+      return;
+    }
+  }
+  // groups are read by home all status in i2c interrupt
+  disableAllInts;
+  for(i = 0; i < numGroups; i++) homeAllGroups[i] = groups[i];
+  homeAllNumGroups = numGroups;
+  homeAllGroupIdx  = 0;
+  enableAllInts;
+  startHomeAllGroup();
+}
+
+// from event loop, for each motor
+void chkHomeAll() {
+  uint8 motBit = (1 << motorIdx);
+  if(homeAllStartMask & motBit) {
+    disableAllInts;
+    homeAllStartMask &= ~motBit;
+    enableAllInts;
+    if(!haveSettings[motorIdx]) {
+      setError(NO_SETTINGS);
+    }
+    else {
+      homeCommand(true);
+      return;
+    }
+  }
+  if((homeAllBusyMask & motBit) && (ms->stateByte & BUSY_BIT) == 0) {
+    disableAllInts;
+    homeAllBusyMask &= ~motBit;
+    enableAllInts;
+    if((ms->stateByte & HOMED_BIT) == 0) {
+      // error or homing interrupted, don't start later groups
+      disableAllInts;
+      homeAllNumGroups = homeAllGroupIdx;
+      enableAllInts;
+    }
+    if(homeAllBusyMask == 0) {
+      startHomeAllGroup();
+    }
+  }
+}
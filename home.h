@@ -10,9 +10,21 @@
 #define goingHome       1
 #define homeReversing   2
 #define homingToOfs     3
+#define homeFastSeek    4
+#define homeRetract     5
+
+// mcu-wide homing, motor groups homed one after another
+// all are read by home all status in i2c interrupt
+extern volatile uint8 homeAllGroups[NUM_MOTORS]; // motor bit masks
+extern volatile uint8 homeAllNumGroups;
+extern volatile uint8 homeAllGroupIdx;
+extern volatile uint8 homeAllStartMask; // motors to start in event loop
+extern volatile uint8 homeAllBusyMask;  // motors in group still homing
 
 void chkHoming(void);
 void homeCommand(bool start);
+void homeAllCommand(uint8 numGroups, volatile uint8 *groups);
+void chkHomeAll(void);
 
 
 #endif	/* HOME_H */
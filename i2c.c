@@ -6,16 +6,31 @@
 #include "i2c.h"
 #include "state.h"
 #include "motor.h"
+#include "home.h"
+#include "eeprom.h"
+#include "move.h"
+#include "clock.h"
+#include "sync.h"
+#include "encoder.h"
 
 uint8 i2cAddrBase; 
 
 volatile uint8 i2cRecvBytes[NUM_MOTORS][RECV_BUF_SIZE+1]; // added len byte
+volatile uint8 i2cSetBytes[SET_BUF_SIZE+1];                // added len byte
+volatile uint8 i2cSetMotIdx = NUM_MOTORS;
+volatile uint8 *i2cRecvBuf;   // buffer of packet being received, 0 if dropped
 volatile uint8 i2cRecvBytesPtr;
 volatile uint8 i2cSendBytes[NUM_SEND_BYTES];
 volatile uint8 i2cSendBytesPtr;
 volatile bool  inPacket;
 volatile bool  packetForUs;
 
+// buffer holding the motor's last received cmd
+// only valid while the motor's haveCommand is set
+volatile uint8 *i2cCmdBuf(uint8 motIdx) {
+  return (i2cSetMotIdx == motIdx ? i2cSetBytes : i2cRecvBytes[motIdx]);
+}
+
 // must be run before RA0 tristate turned off
 void setI2cId(void) {
   IDTRIS  = 1;  // MCU ID pin, 0 for MCU0 (mcuA in p3), 1 for MCU1 (mcuB in p3)
@@ -29,6 +44,7 @@ void i2cInit() {
   SSP1STATbits.SMP  = 0;             // slew-rate enabled
   SSP1STATbits.CKE  = 1;             // smb voltage levels
   SSP1CON2bits.SEN  = 1;             // enable clock stretching 
+  SSP1CON2bits.GCEN = 1;             // general call (go) to all mcus
   SSP1CON3bits.AHEN = 0;             // no clock stretch before addr ack
   SSP1CON3bits.DHEN = 0;             // no clock stretch before data ack
   SSP1CON3bits.BOEN = 1;             // enable buffer overwrite check
@@ -43,25 +59,109 @@ void i2cInit() {
 // all words are big-endian
 void setSendBytesInt(uint8 motIdx) {
   struct motorState *p = &mState[motIdx];
+  uint8 i;
+  // bytes a read type doesn't set are 0, not left from an earlier read
+  for(i = 1; i < NUM_SEND_BYTES; i++) i2cSendBytes[i] = 0;
   switch (p->nextStateSpecialVal) {
     case 0:
       i2cSendBytes[0] = (MCU_VERSION | p->stateByte);
       i2cSendBytes[1] =  p->curPos >> 8;
       i2cSendBytes[2] =  p->curPos & 0x00ff;   
+      // optional, read past 3 bytes for synced time status was taken
+      uint32 t = syncTicksInt();
+      i2cSendBytes[3] = t >> 24;
+      i2cSendBytes[4] = t >> 16;
+      i2cSendBytes[5] = t >>  8;
+      i2cSendBytes[6] = t & 0x00ff;
       break;
     case 1: 
       i2cSendBytes[0] = (MCU_VERSION | AUX_RES_BIT | 0);
       i2cSendBytes[1] = p->homeTestPos >> 8;
       i2cSendBytes[2] = p->homeTestPos & 0x00ff;
+      // optional, read past 3 bytes for drift stats of every home
+      i2cSendBytes[3] = p->driftLast >> 8;
+      i2cSendBytes[4] = p->driftLast & 0x00ff;
+      i2cSendBytes[5] = p->driftMax >> 8;
+      i2cSendBytes[6] = p->driftMax & 0x00ff;
+      i2cSendBytes[7] = p->driftHomes;
+      i2cSendBytes[8] = p->driftOverTol;
       break;        
     case 2: 
       i2cSendBytes[0] = (MCU_VERSION | AUX_RES_BIT | 1);
-      i2cSendBytes[1] = 0; 
-      volatile uint16 *lp = p->limitPort;
-      i2cSendBytes[2] = (lp ? !(*(lp) & p->limitMask) ^ 
+      i2cSendBytes[1] = ((eeBusyMask() >> motIdx) & 0x01); 
+      i2cSendBytes[2] = (p->haveLimSw ? !limPinHi(motIdx) ^ 
                              !!(mSet[motIdx].val.limitSwCtl & LIM_POL_MASK)
         : 0);
       break;      
+    case 3: 
+      i2cSendBytes[0] = (MCU_VERSION | AUX_RES_BIT | 2);
+      // motors not finished with home all, including later groups
+      uint8 pending = homeAllStartMask | homeAllBusyMask;
+      for(i = homeAllGroupIdx; i < homeAllNumGroups; i++) {
+        pending |= homeAllGroups[i];
+      }
+      i2cSendBytes[1] = pending;
+      uint8 errMask = 0, homedMask = 0;
+      for(i = 0; i < NUM_MOTORS; i++) {
+        if(mState[i].stateByte & ERR_CODE)  errMask   |= (0x01 << i);
+        if(mState[i].stateByte & HOMED_BIT) homedMask |= (0x01 << i);
+      }
+#if NUM_MOTORS > 4
+      // homed in byte 2, error in byte 3
+      i2cSendBytes[2] = homedMask;
+      i2cSendBytes[3] = errMask;
+#else
+      // error in top nibble, homed in bottom nibble
+      i2cSendBytes[2] = (errMask << 4) | homedMask;
+#endif
+      break;
+    case 4: 
+      // probe result
+      if(p->probeState == PROBE_HIT || p->probeState == PROBE_DONE) {
+        i2cSendBytes[0] = (MCU_VERSION | AUX_RES_BIT | 3);
+        i2cSendBytes[1] = p->probePos >> 8;
+        i2cSendBytes[2] = p->probePos & 0x00ff;
+      }
+      else {
+        i2cSendBytes[0] = (MCU_VERSION | AUX_RES_BIT | 4);
+        i2cSendBytes[1] = p->curPos >> 8;
+        i2cSendBytes[2] = p->curPos & 0x00ff;
+      }
+      break;
+    case 5: 
+      // encoder pos and worst following error since last read
+      i2cSendBytes[0] = (MCU_VERSION | AUX_RES_BIT | 7);
+      int16 encPos = encoderPosInt(motIdx);
+      i2cSendBytes[1] = encPos >> 8;
+      i2cSendBytes[2] = encPos & 0x00ff;
+      i2cSendBytes[3] = p->encErrMax >> 8;
+      i2cSendBytes[4] = p->encErrMax & 0x00ff;
+      p->encErrMax    = 0;
+      break;
+    case 6: 
+      // worst wake from low power since last read
+      i2cSendBytes[0] = (MCU_VERSION | AUX_RES_BIT | 5);
+      i2cSendBytes[1] = wakeLatencyMax >> 8;
+      i2cSendBytes[2] = wakeLatencyMax & 0x00ff;
+      wakeLatencyMax  = 0;
+      break;
+    case 7: 
+      // oldest error in history (any motor), removed when read
+      i2cSendBytes[0] = (MCU_VERSION | AUX_RES_BIT | 6);
+      if(errHistCount) {
+        struct errHistEntry *e = &errHist[errHistHead];
+        i2cSendBytes[1] = (e->motIdx << 4) | errHistCount;
+        i2cSendBytes[2] =  e->code;
+        i2cSendBytes[3] =  e->ticks >> 8;
+        i2cSendBytes[4] =  e->ticks & 0x00ff;
+        i2cSendBytes[5] =  e->pos >> 8;
+        i2cSendBytes[6] =  e->pos & 0x00ff;
+        i2cSendBytes[7] =  e->speed >> 8;
+        i2cSendBytes[8] =  e->speed & 0x00ff;
+        errHistHead = (errHistHead + 1) & (ERR_HIST_LEN - 1);
+        errHistCount--;
+      }
+      break;
     default: 
       setErrorInt(motIdx, CMD_DATA_ERROR);
   }
@@ -69,6 +169,9 @@ void setSendBytesInt(uint8 motIdx) {
 }
 
 volatile uint8 motIdxInPacket;
+volatile bool  genCallInPacket;  // packet to all mcus, not one motor
+volatile uint8 genCallBytes[GEN_CALL_MAX];
+volatile uint8 genCallLen;
 
 void __attribute__ ((interrupt,shadow,auto_psv)) _MSSP1Interrupt(void) {
   _SSP1IF = 0;
@@ -90,12 +193,18 @@ void __attribute__ ((interrupt,shadow,auto_psv)) _MSSP1Interrupt(void) {
         setErrorInt(motIdxInPacket, OVERFLOW_ERROR);
         I2C_SSPOV = 0;   // clear SSPOV
       }
+      else if(genCallInPacket) {
+        genCallInt(genCallBytes, genCallLen);
+      }
       else {
         if(!RdNotWrite) {
-          // done receiving -- total length of recv is stored in first byte
-          i2cRecvBytes[motIdxInPacket][0] = i2cRecvBytesPtr-1;
-          // tell event loop that data is available
-          mState[motIdxInPacket].haveCommand = true;
+          if(i2cRecvBuf) {
+            // done receiving -- total length of recv is stored in first byte
+            i2cRecvBuf[0] = i2cRecvBytesPtr-1;
+            // tell event loop that data is available
+            mState[motIdxInPacket].haveCommand = true;
+            clkWakeStart();
+          }
         } else {
           // sent last byte of status packet
           if(i2cSendBytes[0] & ERR_CODE) {
@@ -104,35 +213,76 @@ void __attribute__ ((interrupt,shadow,auto_psv)) _MSSP1Interrupt(void) {
           }
         }
       }
+      // settings buffer taken by a packet that was dropped
+      if(i2cSetMotIdx == motIdxInPacket && 
+          !mState[motIdxInPacket].haveCommand) i2cSetMotIdx = NUM_MOTORS;
     }
   }
   else {
     if(!NotAddr) { 
       // received addr byte, extract motor number and read bit
-      packetForUs    = true;
-      motIdxInPacket = (I2C_BUF_BYTE & 0x06) >> 1;
+      uint8 addr      = I2C_BUF_BYTE;
+      genCallInPacket = (addr == 0);
+      genCallLen      = 0;
+      motIdxInPacket  = (addr >> 1) & ((1 << I2C_MOTOR_BITS) - 1);
+      // addr mask covers a power of 2, board may have fewer motors
+      packetForUs     = (genCallInPacket || motIdxInPacket < NUM_MOTORS);
+      i2cRecvBuf      = (packetForUs && !genCallInPacket ? 
+                           i2cRecvBytes[motIdxInPacket] : 0);
       if(RdNotWrite) {
-        // prepare all send data
-        setSendBytesInt(motIdxInPacket);
+        // prepare all send data, none for a motor not on the board
+        if(packetForUs) setSendBytesInt(motIdxInPacket);
         // send packet (i2c read from slave), load buffer for first byte
-        I2C_BUF_BYTE = i2cSendBytes[0];
+        I2C_BUF_BYTE = (packetForUs ? i2cSendBytes[0] : 0);
       }
     }
     else {
-      if(!RdNotWrite) {
+      if(!packetForUs) {
+        // addr mask acked a motor the board doesn't have, drop packet
+        if(RdNotWrite) I2C_BUF_BYTE = 0;
+        else { uint8 b = I2C_BUF_BYTE; (void) b; }
+      }
+      else if(genCallInPacket) {
+        uint8 b = I2C_BUF_BYTE;
+        if(genCallLen < GEN_CALL_MAX) genCallBytes[genCallLen++] = b;
+      }
+      else if(!RdNotWrite) {
         // received byte (i2c write to slave)
         if (mState[motIdxInPacket].haveCommand != 0) {
             // last command for this motor not handled yet by event loop
             setErrorInt(motIdxInPacket, OVERFLOW_ERROR);
         }
-        else {
-          if(i2cRecvBytesPtr < RECV_BUF_SIZE + 1) 
-            i2cRecvBytes[motIdxInPacket][i2cRecvBytesPtr++] = I2C_BUF_BYTE;
+        else if(i2cRecvBuf) {
+          uint8 b = I2C_BUF_BYTE;
+          if(i2cRecvBytesPtr == 1 && (b == 0x1e || b == 0x1f)) {
+            if(i2cSetMotIdx < NUM_MOTORS) {
+              // another motor's settings not handled yet by event loop
+              setErrorInt(motIdxInPacket, OVERFLOW_ERROR);
+              i2cRecvBuf = 0;
+            }
+            else {
+              i2cSetMotIdx = motIdxInPacket;
+              i2cRecvBuf   = i2cSetBytes;
+            }
+          }
+          if(i2cRecvBuf) {
+            if(i2cRecvBytesPtr < (i2cRecvBuf == i2cSetBytes ? 
+                                    SET_BUF_SIZE : RECV_BUF_SIZE) + 1)
+              i2cRecvBuf[i2cRecvBytesPtr++] = b;
+            else {
+              // too long, dropped rather than run cut short
+              setErrorInt(motIdxInPacket, CMD_DATA_ERROR);
+              i2cRecvBuf = 0;
+            }
+          }
         }
+        else { uint8 b = I2C_BUF_BYTE; (void) b; }
       }
       else {
         // sent byte (i2c read from slave), load buffer for next send
-        I2C_BUF_BYTE = i2cSendBytes[i2cSendBytesPtr++];
+        if(i2cSendBytesPtr < NUM_SEND_BYTES)
+             I2C_BUF_BYTE = i2cSendBytes[i2cSendBytesPtr++];
+        else I2C_BUF_BYTE = 0;
       }
     }
   }
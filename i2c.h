@@ -4,17 +4,17 @@
 #include <xc.h>
 #include "types.h"
 #include "motor.h"
+#include "move.h"
 
-#define RECV_BUF_SIZE   (NUM_SETTING_WORDS*2 + 1) // + opcode byte
-#define NUM_SEND_BYTES   3  //  state, posH, posL
+// settings cmds are the longest, one buffer holds them for all motors
+// every other cmd, up to a full path, fits in the motor's own buffer
+#define SET_BUF_SIZE    (NUM_SETTING_WORDS*2 + 2) // + opcode and index bytes
+#define RECV_BUF_SIZE   ((MOVE_Q_LEN + 1)*4 + 1)  // + opcode byte
+#define NUM_SEND_BYTES   9  //  state, posH, posL (longer for time or error history)
 
-#define I2C_ADDR_MASK 0xf8 // motor idx in d2-d1 (d1-d0 in real addr)
-
-// motor is bottom 2 bits in addr
+// motor is bottom I2C_MOTOR_BITS of addr, addrs and mask are in pins.h
 // addr is set based on ID input pin
 extern uint8 i2cAddrBase; 
-#define I2C_ADDR_0   0x08  // real addr: 0x04+motor
-#define I2C_ADDR_1   0x10  // real addr: 0x08+motor
   
 #define RdNotWrite SSP1STATbits.I2C_READ
 #define NotAddr    SSP1STATbits.NOT_ADDRESS
@@ -22,10 +22,13 @@ extern uint8 i2cAddrBase;
 #define I2C_SSPOV  SSP1CON1bits.SSPOV
 
 extern volatile uint8 i2cRecvBytes[NUM_MOTORS][RECV_BUF_SIZE + 1];
+extern volatile uint8 i2cSetBytes[SET_BUF_SIZE + 1];
+extern volatile uint8 i2cSetMotIdx;  // motor holding i2cSetBytes, NUM_MOTORS if free
 extern volatile uint8 i2cRecvBytesPtr;
 extern volatile uint8 i2cSendBytes[NUM_SEND_BYTES];
 extern volatile uint8 i2cSendBytesPtr;
 
+volatile uint8 *i2cCmdBuf(uint8 motIdx);
 void setI2cId(void);
 void i2cInit(void);
 void i2cInterrupt(void);
@@ -45,6 +45,125 @@
 #include "motor.h"
 #include "clock.h"
 #include "dist-table.h"
+#include "home.h"
+#include "eeprom.h"
+#include "move.h"
+#include "sync.h"
+
+// motorIdx, ms, and sv are globals
+void serviceMotor(uint8 motIdx) {
+  motorIdx = motIdx;
+  ms = &mState[motorIdx];      // state array
+  ss = &sState[motorIdx];      // interrupt step state
+  sv = &(mSet[motorIdx].val);  // settings array
+  if(errorIntCode[motorIdx]) {
+    // error happened during interrupt
+    disableAllInts;
+    uint8 err = errorIntCode[motorIdx];
+    errorIntCode[motorIdx] = 0;
+    enableAllInts;
+    errorState(err);
+  }
+  if(ms->haveCommand) {
+    processCommand(i2cCmdBuf(motorIdx));
+    // free the settings buffer for the next settings cmd, any motor
+    if(i2cSetMotIdx == motorIdx) i2cSetMotIdx = NUM_MOTORS;
+    ms->haveCommand = false;
+  }
+  chkHomeAll();
+  checkAll();  // foreground event loop
+}
+
+// motors with work to do in event loop, as bit mask
+// a moving motor with its next step already pending needs nothing
+uint8 motorsNeedingService() {
+  uint8 mask = 0;
+  uint8 motIdx;
+  for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
+    struct motorState *p = &mState[motIdx];
+    struct stepState  *s = &sState[motIdx];
+    if(p->haveCommand                                   ||
+       errorIntCode[motIdx]                             ||
+       ((p->stateByte & BUSY_BIT) && !s->segMode &&
+          !p->stepHeld && stepsPlanned(s) < STEP_Q_LEN) ||
+       (s->segMode && !segsActive(s))                   ||
+       p->probeState == PROBE_HIT                       ||
+       ((homeAllStartMask | homeAllBusyMask) & (1 << motIdx))) {
+      mask |= (1 << motIdx);
+    }
+  }
+  return mask;
+}
+
+// nothing to do until an interrupt brings a command
+bool mcuIdle() {
+  uint8 motIdx;
+  for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
+    struct motorState *p = &mState[motIdx];
+    if((p->stateByte & BUSY_BIT) || p->haveCommand || 
+        errorIntCode[motIdx]) return false;
+  }
+  // armed and timed cmds keep full timing so they start on the tick
+  return (!homeAllStartMask && !homeAllBusyMask && !eeBusyMask() && 
+          !goPending && !haveArmedCmds() && !timedCount);
+}
+
+// one pass of the event loop, also called by the host sim in sim/
+void eventLoopPass() {
+  static uint8 idleMotIdx = 0;
+  if(clkLowPowerOn && !mcuIdle()) {
+    // woken with work to do, back to full timing before doing it
+    clkLowPower(false);
+  }
+  chkGo();
+  chkTimed();
+  // one motor per pass is always serviced for fault checks, etc.
+  uint8 svcMask = motorsNeedingService() | (1 << idleMotIdx);
+  if(++idleMotIdx == NUM_MOTORS) idleMotIdx = 0;
+  
+  // earliest deadline first, a step that is done has a deadline in the past
+  while(svcMask) {
+    uint16 now = timeTicks;
+    uint8  motIdx, bestIdx = 0;
+    int16  bestSlack = 0x7fff;
+    for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
+      if(svcMask & (1 << motIdx)) {
+        struct stepState *s = &sState[motIdx];
+        int16 slack;
+        if((mState[motIdx].stateByte & BUSY_BIT) == 0 || s->segMode ||
+           (stepsPlanned(s) == 0 && mState[motIdx].stepHeld)) 
+          slack = 0x7fff;           // idle, interrupt stepping segments, or step held
+        else if(stepsPlanned(s) == 0) 
+          slack = (int16) 0x8000;   // nothing left for interrupt to output
+        else 
+          slack = (int16) (s->stepQTicks[s->stepQFire & (STEP_Q_LEN-1)] - now);
+        if(slack <= bestSlack) {
+          bestSlack = slack;
+          bestIdx   = motIdx;
+        }
+      }
+    }
+    svcMask &= ~(1 << bestIdx);
+    serviceMotor(bestIdx);
+  }
+  chkEeprom();
+  // a command from here on is timed for the wake latency
+  clkIdling = true;
+  if(mcuIdle()) {
+    // cpu sleeps until next interrupt (i2c, limit sw, or slow timer)
+    clkLowPower(true);
+    // a command that came after the check wakes idle at once
+    // with ints disabled idle still wakes, the int runs after
+    disableAllInts;
+    if(mcuIdle()) Idle();
+    enableAllInts;
+  }
+  else if(!clkLowPowerOn) {
+    // command came before sleeping, it waited no slow int
+    wakeStarted = false;
+  }
+  clkIdling = false;
+}
 
 int main(void) {
  _RCDIV  = 0; // switch instruction clock from 4 MHz to 8 MHz
@@ -73,21 +192,5 @@ int main(void) {
   enableAllInts;
   
   // main event loop -- never ends
-  while(true) {
-    // motorIdx, ms, and sv are globals
-    for(motorIdx=0; motorIdx < NUM_MOTORS; motorIdx++) {
-      ms = &mState[motorIdx];      // state array
-      sv = &(mSet[motorIdx].val);  // settings array
-      if(errorIntCode && errorIntMot == motorIdx) {
-        // error happened during interrupt
-        setError(errorIntCode);
-        errorIntCode = 0;
-      }
-      if(ms->haveCommand) {
-        processCommand();
-        ms->haveCommand = false;
-      }
-      checkAll();  // foreground event loop
-   }
-  }
+  while(true) eventLoopPass();
 }
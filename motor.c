@@ -9,64 +9,41 @@
 #include "home.h"
 #include "move.h"
 #include "stop.h"
+#include "eeprom.h"
+#include "sync.h"
+#include "encoder.h"
 
 bool haveSettings[NUM_MOTORS];
 union settingsUnion mSet[NUM_MOTORS];
 
-// these should be in state record
-
-volatile uint16 *stepPort[NUM_MOTORS] = {&stepAPORT, &stepBPORT, &stepCPORT, &stepDPORT};
-const    uint16  stepMask[NUM_MOTORS] = {stepABIT, stepBBIT, stepCBIT, stepDBIT};
-
-volatile uint16 *resetPort[NUM_MOTORS] = {&resetAPORT, &resetBPORT, &resetCPORT, &resetDPORT};
-const    uint16  resetMask[NUM_MOTORS] = {resetABIT, resetBBIT, resetCBIT, resetDBIT};
-
-volatile uint16 *faultPort[NUM_MOTORS] = {&faultAPORT, &faultBPORT, &faultCPORT, &faultDPORT};
-const    uint16  faultMask[NUM_MOTORS] = {faultABIT, faultBBIT, faultCBIT, faultDBIT};
-         
-volatile uint16 *limPort[NUM_MOTORS]   = {&limAPORT, &limBPORT, &limCPORT, &limDPORT};
-const    uint16  limMask[NUM_MOTORS]   = {limABIT, limBBIT, limCBIT, limDBIT};
-         
 // globals for use in main chk loop
 uint8                 motorIdx;
 struct motorState    *ms;
+struct stepState     *ss;
 struct motorSettings *sv;
 
 void motorInit() {
  dirTRIS = 0;
   ms1TRIS = 0;
   ms2TRIS = 0;
-  
-  resetALAT  = 0; // start with reset on
-  resetATRIS = 0;
-  resetBLAT  = 0; // start with reset on
-  resetBTRIS = 0;
-  resetCLAT  = 0; // start with reset on
-  resetCTRIS = 0;
-  resetDLAT  = 0; // start with reset on
-  resetDTRIS = 0;
-  
-  stepALAT   = 1; 
-  stepBLAT   = 1; 
-  stepCLAT   = 1; 
-  stepDLAT   = 1; 
-
-  stepATRIS  = 0;
-  stepBTRIS  = 0;
-  stepCTRIS  = 0;
-  stepDTRIS  = 0;
 
 #ifndef DEBUG
-  faultATRIS = 1; // zero input means motor fault
-  faultBTRIS = 1; 
-  faultCTRIS = 1;  
-  faultDTRIS = 1;  
+#define faultPinInit(_m) fault##_m##TRIS = 1; // zero input means motor fault
+#else
+#define faultPinInit(_m)                      // fault pins are test points
 #endif
-  
-  limATRIS = 1; // limit switch input
-  limBTRIS = 1; 
-  limCTRIS = 1; 
-  limDTRIS = 1; 
+#define motorPinInit(_m, _idx)                                      \
+  reset##_m##LAT  = 0; /* start with reset on */                    \
+  reset##_m##TRIS = 0;                                              \
+  step##_m##LAT   = 1;                                              \
+  step##_m##TRIS  = 0;                                              \
+  faultPinInit(_m)                                                  \
+  lim##_m##TRIS   = 1; /* limit switch input */                     \
+  lim##_m##CNIE   = 1; /* limit switch edges interrupt */
+  forEachMotor(motorPinInit)
+  encoderInit();
+  _CNIF    = 0;
+  _CNIE    = 1;
 
   uint8 motIdx;
   for (motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
@@ -75,31 +52,64 @@ void motorInit() {
     msp->stateByte = 0; // no err, not busy, motor off, and not homed
     msp->phase = 0; // cur step phase
     msp->haveCommand = false;
-    msp->stepPending = false;
-    msp->stepped = false;
+    sState[motIdx].stepQFire = 0;
+    sState[motIdx].stepQPlan = 0;
     msp->curSpeed = 0;
+    msp->homeRefValid = false;
+    msp->homeDriftValid = false;
+    msp->driftLast = 0;
+    msp->driftMax = 0;
+    msp->driftHomes = 0;
+    msp->driftOverTol = 0;
+    msp->probeState = PROBE_IDLE;
+    msp->moveQHead = 0;
+    msp->moveQCount = 0;
+  }
+  // settings saved in eeprom make motors ready without host
+  for (motorIdx = 0; motorIdx < NUM_MOTORS; motorIdx++) {
+    ms = &mState[motorIdx];
+    ss = &sState[motorIdx];
+    sv = &(mSet[motorIdx].val);
+    if(eeLoadSettings(motorIdx)) {
+      applySettings();
+    }
   }
 }
 #include "i2c.h" // DEBUG
 
+bool resetIsLo() {
+#define retResetIsLo(_m) return resetPinIsLo(_m)
+  motorSwitch(motorIdx, retResetIsLo);
+}
+
 bool haveFault() {
 #ifdef DEBUG
   return false;
 #else
   if(i2cAddrBase == I2C_ADDR_1 && motorIdx == 2) 
            return false;  // DEBUG -- IGNORE BAD MCUB CHIP A4 input -- TODO
-  volatile uint16 *p = faultPort[motorIdx];
-  return !(*p & faultMask[motorIdx]);
+#define retFaultIsLo(_m) return faultPinIsLo(_m)
+  motorSwitch(motorIdx, retFaultIsLo);
 #endif
 }
 
+// also from i2c interrupt
+bool limPinHi(uint8 motIdx) {
+#define retLimIsHi(_m) return limPinIsHi(_m)
+  motorSwitch(motIdx, retLimIsHi);
+}
+
 bool limitSwOn() {
-  volatile uint16 *p = ms->limitPort;
-  if (p != 0) {
-    bool swOn;
-    if(ms->limActThres)
-         swOn =  (ms->limitCntTimeout > ms->limActThres);
-    else swOn = !(*p & ms->limitMask);
+  if (ms->haveLimSw) {
+    bool   swOn;
+    uint16 thres = limActThres(sv->limitSwCtl);
+    if(thres) {
+      // switch is closed when there is no activity for timeout
+      disableAllInts;
+      swOn = ((uint16) (timeTicks - ms->limEdgeTicks) > thres);
+      enableAllInts;
+    }
+    else swOn = !limPinHi(motorIdx);
     return ((sv->limitSwCtl & LIM_POL_MASK) ? !swOn : swOn);
   }
   return false;
@@ -108,25 +118,156 @@ bool limitSwOn() {
 // setting words are big endian
 // write may be short, only setting first entries
 
-void setMotorSettings(uint8 numWordsRecvd) {
+// value a setting word can't hold, an index into a table
+bool badSetting(uint8 idx, uint16 val) {
+  return (idx == accelSettingIdx    && val > 7) ||
+         (idx == maxUstepSettingIdx && val > MAX_USTEP);
+}
+
+// any bad word drops the whole write, no setting is changed
+bool badSettings(volatile uint8 *wb, uint8 firstIdx, uint8 numWords) {
   uint8 i;
+  for (i = 0; i < numWords; i++) {
+    if(badSetting(firstIdx + i, (wb[2 * i] << 8) | wb[2 * i + 1])) {
+      setError(CMD_DATA_ERROR);
+      return true;
+    }
+  }
+  return false;
+}
+
+void setMotorSettings(volatile uint8 *rb, uint8 numWordsRecvd) {
+  uint8 i;
+  if(badSettings(&rb[2], 0, numWordsRecvd)) return;
   for (i = 0; i < numWordsRecvd; i++) {
-    mSet[motorIdx].reg[i] = (i2cRecvBytes[motorIdx][2 * i + 2] << 8) |
-                             i2cRecvBytes[motorIdx][2 * i + 3];
+    uint16 val = (rb[2 * i + 2] << 8) | rb[2 * i + 3];
+    if((i == homingDirSettingIdx || i == homeOfsSettingIdx || 
+        i == homePosSettingIdx) && val != mSet[motorIdx].reg[i]) {
+      // same settings sent again keep drift measurement going
+      applySetting(i);
+    }
+    mSet[motorIdx].reg[i] = val;
   }
-  ms->acceleration = accelTable[mSet[motorIdx].val.accelIdx];
-  uint16 lsc = mSet[motorIdx].val.limitSwCtl;
-  if(lsc) {
-    ms->limitPort   = limPort[motorIdx];
-    ms->limitMask   = limMask[motorIdx];
-    ms->limActThres = (lsc & LIM_ACT_TIMEOUT_MASK) >> (LIM_ACT_TIMEOUT_OFS-6);
-    ms->limActHyst  = (lsc & LIM_ACT_HYST_MASK)    << (5-LIM_ACT_HYST_OFS);
+  applySettings();
+}
+
+// indexed write, only state depending on written settings is changed
+// so it is safe while this or other motors are moving
+void setMotorSettingsAt(volatile uint8 *rb, uint8 firstIdx, uint8 numWords) {
+  uint8 i;
+  if(badSettings(&rb[3], firstIdx, numWords)) return;
+  for (i = 0; i < numWords; i++) {
+    mSet[motorIdx].reg[firstIdx + i] = (rb[2 * i + 3] << 8) | rb[2 * i + 4];
+    applySetting(firstIdx + i);
   }
-  setTicksSec();
-  clkTicksPerSec = ((uint16) (1000000 / mSet[0].val.mcuClock));
+}
+
+// update state that depends on one setting
+void applySetting(uint8 idx) {
+  switch(idx) {
+    case accelSettingIdx:
+      ms->acceleration = accelTable[mSet[motorIdx].val.accelIdx];
+      break;
+    case limitSwCtlSettingIdx:
+      // timeout and hyst are read from the setting where used
+      ms->haveLimSw = (mSet[motorIdx].val.limitSwCtl != 0);
+      if(ms->haveLimSw) ms->limLevel = limPinHi(motorIdx);
+      break;
+    case mcuClockSettingIdx:
+      if(mSet[0].val.mcuClock) {
+        // motor 0 may not have settings yet
+        setTicksSec();
+        clkTicksPerSec = ((uint16) (1000000 / mSet[0].val.mcuClock));
+      }
+      break;
+    case encRatioSettingIdx:
+      applyEncSetting();
+      break;
+    case homingDirSettingIdx:
+    case homeOfsSettingIdx:
+    case homePosSettingIdx:
+      // drift is measured against the edge pos these gave at last home
+      ms->homeDriftValid = false;
+      break;
+  }
+}
+
+// update state that depends on settings, mSet already loaded
+void applySettings() {
+  applySetting(accelSettingIdx);
+  applySetting(limitSwCtlSettingIdx);
+  applySetting(mcuClockSettingIdx);
+  applySetting(encRatioSettingIdx);
   haveSettings[motorIdx] = true;
 }
 
+// bookkeeping for step just planned with ms->ustep and ms->curDir
+// done when planned so next step is planned from this one
+void commitStep(uint8 qIdx) {
+  uint8 stepDist = uStepDist[ms->ustep];
+  int8  signedDist = ((ms->curDir) ? stepDist : -stepDist); 
+  ms->phase += signedDist;
+  ms->stepQBacklash[qIdx] = ms->backlashPos;
+    
+  if(sv->backlashWid) {
+    if((ms->backlashPos < 0) && ms->curDir) {
+      // reversing from backward to forward outside dead zone
+      ms->backlashPos = stepDist;
+      signedDist -= sv->backlashWid;
+      if(signedDist < 0) signedDist = 0;
+    }
+    else if((ms->backlashPos >= (int16) sv->backlashWid) && !ms->curDir) {
+      // reversing from forward to backward outside dead zone
+      ms->backlashPos = sv->backlashWid - stepDist;
+      signedDist += sv->backlashWid;
+      if(signedDist > 0) signedDist = 0;
+    }
+    else if(ms->backlashPos >= 0 && ms->backlashPos < (int16) sv->backlashWid){
+      // moving inside backlash dead zone
+      ms->backlashPos += signedDist;
+      if(ms->backlashPos < 0) {
+        signedDist = ms->backlashPos;
+      }
+      else if(ms->backlashPos >= (int16) sv->backlashWid) {
+        signedDist = ms->backlashPos - sv->backlashWid;
+      }
+      else signedDist = 0;
+    }
+  }
+  ms->curPos += signedDist;
+  ms->stepQPosDelta[qIdx] = signedDist;
+}
+
+// undo bookkeeping of planned steps that were not output
+void cancelSteps() {
+  disableAllInts;
+  // held step is in the slot after the last one the interrupt has
+  if(ms->stepHeld) ss->stepQPlan++;
+  ms->stepHeld = false;
+  while(ss->stepQPlan != ss->stepQFire) {
+    ss->stepQPlan--;
+    uint8 qIdx     = ss->stepQPlan & (STEP_Q_LEN - 1);
+    uint8 ctl      = ss->stepQCtl[qIdx];
+    uint8 stepDist = uStepDist[ctl & 0x03];
+    ms->phase      -= ((ctl & STEP_DIR_BIT) ? stepDist : -stepDist);
+    ms->curPos     -= ms->stepQPosDelta[qIdx];
+    ms->backlashPos = ms->stepQBacklash[qIdx];
+  }
+  enableAllInts;
+}
+
+// curPos less the planned steps the interrupt has not output yet
+int16 outputPos() {
+  disableAllInts;
+  int16 pos = ms->curPos;
+  uint8 i;
+  for(i = ss->stepQFire; i != (uint8) (ss->stepQPlan + ms->stepHeld); i++) {
+    pos -= ms->stepQPosDelta[i & (STEP_Q_LEN - 1)];
+  }
+  enableAllInts;
+  return pos;
+}
+
 // from event loop
 
 void checkAll() {
@@ -134,55 +275,30 @@ void checkAll() {
     setError(MOTOR_FAULT_ERROR);
     return;
   }
-  if (ms->stepPending) {
+  chkFollowing();
+  if (stepsPlanned(ss) == STEP_Q_LEN) {
+    // planned as far ahead as possible
     return;
   }
-  if (ms->stepped) {
-    ms->stepped = false;
-    uint8 stepDist = uStepDist[ms->ustep];
-    int8  signedDist = ((ms->curDir) ? stepDist : -stepDist); 
-    ms->phase += signedDist;
-    
-    if(sv->backlashWid) {
-      if((ms->backlashPos < 0) && ms->curDir) {
-        // reversing from backward to forward outside dead zone
-        ms->backlashPos = stepDist;
-        signedDist -= sv->backlashWid;
-        if(signedDist < 0) signedDist = 0;
-      }
-      else if((ms->backlashPos >= (int16) sv->backlashWid) && !ms->curDir) {
-        // reversing from forward to backward outside dead zone
-        ms->backlashPos = sv->backlashWid - stepDist;
-        signedDist += sv->backlashWid;
-        if(signedDist > 0) signedDist = 0;
-      }
-      else if(ms->backlashPos >= 0 && ms->backlashPos < (int16) sv->backlashWid){
-        // moving inside backlash dead zone
-        ms->backlashPos += signedDist;
-        if(ms->backlashPos < 0) {
-          signedDist = ms->backlashPos;
-        }
-        else if(ms->backlashPos >= (int16) sv->backlashWid) {
-          signedDist = ms->backlashPos - sv->backlashWid;
-        }
-        else signedDist = 0;
-      }
-    }
-    ms->curPos += signedDist;
-    
-    if(ms->limActThres) {
-      ms->limitCntTimeout ++;
-      if(*ms->limitPort & ms->limitMask) {
-        if(ms->limitCountLo > ms->limActHyst) ms->limitCntTimeout = 0;
-        ms->limitCountHi++;
-        ms->limitCountLo = 0;
-      }
-      else {
-        if(ms->limitCountHi > ms->limActHyst) ms->limitCntTimeout = 0;
-        ms->limitCountLo++;
-        ms->limitCountHi = 0;
-      }
-    }
+  uint16 thres = limActThres(sv->limitSwCtl);
+  if(thres) {
+    // keep activity timeout from wrapping when idle a long time
+    disableAllInts;
+    if((uint16) (timeTicks - ms->limEdgeTicks) > thres)
+      ms->limEdgeTicks = timeTicks - thres - 1;
+    enableAllInts;
+  }
+  if (ms->probeState == PROBE_HIT) {
+    softStopCommand(false);
+    ms->probeState = PROBE_DONE;
+  }
+  else if (ms->probeState == PROBE_ARMED && (ms->stateByte & BUSY_BIT) == 0) {
+    ms->probeState = PROBE_MISSED;
+  }
+  if (ss->segMode) {
+    // interrupt steps host segments, done when all are stepped
+    if (!segsActive(ss)) stopStepping();
+    return;
   }
   if ((ms->stateByte & BUSY_BIT) && !haveError()) {
     if (ms->homing) {
@@ -209,6 +325,14 @@ void motorOn() {
     setResetHi();
     // counter in drv8825 is cleared by reset
     // ms->phase always matches internal phase counter in drv8825
+    if(ms->homeRefValid) {
+      // motor snaps to nearest phase zero, adjust pos to match
+      int8 phaseOfs = ms->phase & PHASE_CYCLE_MASK;
+      if(phaseOfs >= 16) phaseOfs -= 32;
+      ms->curPos -= phaseOfs;
+      ms->homeRefValid = false;
+      setStateBit(HOMED_BIT, 1);
+    }
     ms->phase = 0;
   }
 }
@@ -228,13 +352,18 @@ bool lenIs(uint8 expected, bool chkSettings) {
   return true;
 }
 
-void processCommand() {
-  volatile uint8 *rb = ((volatile uint8 *) i2cRecvBytes[motorIdx]);
+// rb[0] is length, from i2c or from cmd armed for go
+void processCommand(volatile uint8 *rb) {
   numBytesRecvd   = rb[0];
   uint8 firstByte = rb[1];
   if ((firstByte & 0x80) == 0x80) {
     if (lenIs(2, true)) {
       // move command
+      if(sv->speed == 0) {
+        // speed 0 would never arrive
+        setError(CMD_DATA_ERROR);
+        return;
+      }
       ms->targetSpeed = sv->speed;
       ms->targetPos = ((int16) (firstByte & 0x7f) << 8) | rb[2];
       moveCommand(false);
@@ -242,6 +371,10 @@ void processCommand() {
   } else if ((firstByte & 0xc0) == 0x40) {
     // speed-move command
     if (lenIs(3, true)) {
+      if((firstByte & 0x3f) == 0) {
+        setError(CMD_DATA_ERROR);
+        return;
+      }
       // changes settings for speed
       sv->speed = (uint16) (firstByte & 0x3f) << 8;
       ms->targetSpeed = sv->speed;
@@ -251,6 +384,10 @@ void processCommand() {
   } else if ((firstByte & 0xf8) == 0x08) {
     // accel-speed-move command
     if (lenIs(5, true)) {
+      if(rb[2] == 0 && rb[3] == 0) {
+        setError(CMD_DATA_ERROR);
+        return;
+      }
       // changes settings for acceleration and speed
       sv->accelIdx = (firstByte & 0x07);
       sv->speed = (((uint16) rb[2] << 8) | rb[3]);
@@ -289,17 +426,76 @@ void processCommand() {
       ms->targetSpeed  = sv->jerk;
       moveCommand(true);
     }
+  } else if (firstByte == 0x00) {
+    // queued speed-move (path) command, one or more waypoints
+    // does not change speed setting
+    uint8 count = (numBytesRecvd - 1) >> 2;
+    if (count == 0) {
+      setError(CMD_DATA_ERROR);
+    } else if (lenIs((count << 2) + 1, true)) {
+      pathCommand(&rb[2], count);
+    }
   } else if (firstByte == 0x01) {
     // setPos command
     if (lenIs(3, false)) {
-      ms->curPos =  (int16) (((uint16) rb[2] << 8) | rb[3]);
+      int16 pos = (int16) (((uint16) rb[2] << 8) | rb[3]);
+      // encoder follows the new pos, even while moving
+      ms->encRefPos   += pos - ms->curPos;
+      ms->curPos         = pos;
+      ms->homeRefValid   = false;
+      ms->homeDriftValid = false;
+    }
+  } else if (firstByte == 0x11) {
+    // arm command, cmd that follows is started by general call go
+    armCommand(&rb[2], numBytesRecvd - 1);
+  } else if (firstByte == 0x1c) {
+    // timed command, cmd that follows is started at synced time
+    if (numBytesRecvd == 1) {
+      timedCommand(0, 0, 0);
+    } else if (numBytesRecvd >= 6) {
+      timedCommand(((uint32) rb[2] << 24) | ((uint32) rb[3] << 16) |
+                   ((uint16) rb[4] <<  8) | rb[5], &rb[6], numBytesRecvd - 5);
+    } else {
+      setError(CMD_DATA_ERROR);
+    }
+  } else if (firstByte == 0x17) {
+    // home all command, each byte is mask of motors homed in parallel
+    uint8 numGroups = numBytesRecvd - 1;
+    if(numGroups > 0 && numGroups <= NUM_MOTORS) {
+      homeAllCommand(numGroups, &rb[2]);
+    } else {
+      setError(CMD_DATA_ERROR);
+    }
+  } else if (firstByte == 0x1a) {
+    // probe command, move until limit switch changes
+    if (lenIs(5, true)) {
+      probeCommand((int16) (((uint16) rb[4] << 8) | rb[5]),
+                            ((uint16) rb[2] << 8) | rb[3]);
+    }
+  } else if (firstByte == 0x1b) {
+    // step segment command, stepped by interrupt without planning
+    if (lenIs(8, true)) {
+      motorOn();
+      segmentCommand(((uint16) rb[2] << 8) | rb[3],
+                     ((uint16) rb[4] << 8) | rb[5],
+                     (int16) (((uint16) rb[6] << 8) | rb[7]), rb[8]);
+    }
+  } else if (firstByte == 0x1e) {
+    // indexed settings command, rb[2] is index of first setting written
+    uint8 numWords = (numBytesRecvd - 2) / 2;
+    if (lenIs(numWords * 2 + 2, true)) {
+      if(numWords > 0 && rb[2] + numWords <= NUM_SETTING_WORDS) {
+        setMotorSettingsAt(rb, rb[2], numWords);
+      } else {
+        setError(CMD_DATA_ERROR);
+      }
     }
   } else if (firstByte == 0x1f) {
     // load settings command
     uint8 numWords = (numBytesRecvd - 1) / 2;
     if ((numBytesRecvd & 0x01) == 1 &&
             numWords > 0 && numWords <= NUM_SETTING_WORDS) {
-      setMotorSettings(numWords);
+      setMotorSettings(rb, numWords);
     } else {
       setError(CMD_DATA_ERROR);
     }
@@ -307,13 +503,17 @@ void processCommand() {
    // 2-byte extra commands
     if (lenIs(2, true)) {
       if((rb[2] & 0xf8) == 0x08) {
-        // clamp or unclamp limit switch to ground
-        switch(rb[2] & 0x06) {
-          case 0: limALAT = 0; limATRIS = (rb[2] & 0x01); break;
-          case 2: limBLAT = 0; limBTRIS = (rb[2] & 0x01); break;
-          case 4: limCLAT = 0; limCTRIS = (rb[2] & 0x01); break;
-          case 6: limDLAT = 0; limDTRIS = (rb[2] & 0x01); break;
+        // clamp or unclamp limit switch to ground, motors A-D only
+        uint8 limIdx = (rb[2] & 0x06) >> 1;
+#define clampLim(_m) lim##_m##LAT = 0; lim##_m##TRIS = (rb[2] & 0x01)
+        if(limIdx < NUM_MOTORS) {
+          motorSwitch(limIdx, clampLim);
+        } else {
+          setError(CMD_DATA_ERROR);
         }
+      } else if((rb[2] & 0xf8) == 0x10) {
+        // next status contains special value of any type
+        ms->nextStateSpecialVal = (rb[2] & 0x07) + 1;
       } else {
         setError(CMD_DATA_ERROR);
       }
@@ -331,7 +531,7 @@ void processCommand() {
 
     uint8 bottomNib = firstByte & 0x0f;
     // one-byte commands
-    if (lenIs(1, (bottomNib != 4 && bottomNib != 7))) {
+    if (lenIs(1, (bottomNib != 4 && bottomNib != 7 && bottomNib != 9))) {
       switch (bottomNib) {
         case 0: homeCommand(true);           break; // start homing
         case 2: softStopCommand(false);      break; // stop,no reset
@@ -339,31 +539,120 @@ void processCommand() {
         case 4: resetMotor();                break; // hard stop (immediate reset)
         case 5: motorOn();                   break; // reset off
         case 6: homeCommand(false);          break; // stop, set curpos to setting
+        case 8: eeSaveCommand(false);        break; // save settings in eeprom
+        case 9: eeSaveCommand(true);         break; // clear saved settings
         default: setError(CMD_DATA_ERROR);
       }
     }
   } 
   else setError(CMD_DATA_ERROR);
 }
+// step output of one motor, always inlined with a constant motIdx
+// so state addresses, ports and bits are all known at compile time
+static inline __attribute__((always_inline)) void stepMotorInt(uint8 motIdx) {
+  struct stepState *s = &sState[motIdx];
+  if (s->stepQPlan != s->stepQFire) {
+    uint8 qIdx = s->stepQFire & (STEP_Q_LEN - 1);
+    if (s->stepQTicks[qIdx] == timeTicks) {
+      uint8 ctl = s->stepQCtl[qIdx];
+      ms1LAT = ((ctl & 0x01) ? 1 : 0);
+      ms2LAT = ((ctl & 0x02) ? 1 : 0);
+      dirLAT = ((ctl & STEP_DIR_BIT) ? 1 : 0);
+      motorSwitch(motIdx, stepPinHi);
+      s->stepQFire++;
+    }
+  }
+  else if (s->segMode) {
+    if (s->seg.count == 0 && s->segQHead != s->segQTail) {
+      // next host segment continues from time of last step
+      s->seg       = moveQ[motIdx].seg[s->segQHead];
+      s->segQHead  = (s->segQHead + 1) & (SEG_Q_LEN - 1);
+      s->segTicks += s->seg.interval;
+      if ((int16) (s->segTicks - timeTicks) <= 0) {
+        // host sent segment too late
+        s->seg.count = 0;
+        s->segQHead  = s->segQTail;
+        setErrorInt(motIdx, STEP_NOT_DONE_ERROR);
+      }
+    }
+    else if (s->seg.count && s->segTicks == timeTicks) {
+      struct motorState *p = &mState[motIdx];
+      uint8 ctl = s->seg.ctl;
+      ms1LAT = ((ctl & 0x01) ? 1 : 0);
+      ms2LAT = ((ctl & 0x02) ? 1 : 0);
+      dirLAT = ((ctl & STEP_DIR_BIT) ? 1 : 0);
+      motorSwitch(motIdx, stepPinHi);
+      // no backlash, host plans exact steps
+      uint8 dist = uStepDist[ctl & 0x03];
+      if (ctl & STEP_DIR_BIT) {
+        p->curPos += dist;
+        p->phase  += dist;
+      } else {
+        p->curPos -= dist;
+        p->phase  -= dist;
+      }
+      if (--s->seg.count) {
+        // only adds in interrupt, host did the divides
+        s->seg.interval += s->seg.add;
+        s->segTicks     += s->seg.interval;
+      }
+    }
+  }
+}
+
 void __attribute__((interrupt, shadow, auto_psv)) _T1Interrupt(void) {
+#ifdef DEBUG
+  dbg11  // tp1 high while in interrupt, time it with a scope
+#endif
   _T1IF = 0;
-  timeTicks++;
+  timeTicks += clkTicksPerInt;
+  if (timeTicks < clkTicksPerInt) timeTicksHi++;
+  // end step pulses from last tick, cheaper than checking which are high
+#define endStepPulse(_m, _idx) stepPinLo(_m);
+  forEachMotor(endStepPulse)
+  // unrolled, one copy of the step code per motor
+#define stepMotor(_m, _idx) stepMotorInt(_idx);
+  forEachMotor(stepMotor)
+#ifdef DEBUG
+  dbg10
+#endif
+}
+
+// input change on any limit switch or encoder pin
+// edge time and position are latched here so they don't depend on step rate
+void __attribute__((interrupt, shadow, auto_psv)) _CNInterrupt(void) {
+  _CNIF = 0;
+  forEachEnc(encDecode)
+  // all pins read first with constant ports, bit per motor
+  uint8 levels = 0;
+#define readLimPin(_m, _idx) if (limPinIsHi(_m)) levels |= (1 << _idx);
+  forEachMotor(readLimPin)
   int motIdx;
   for (motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
     struct motorState *p = &mState[motIdx];
-    if (p->stepPending && p->nextStepTicks == timeTicks) {
-      if (p->stepped) {
-        // last motor step not handled yet
-        setErrorInt(motIdx, STEP_NOT_DONE_ERROR);
-        return;
+    if (p->haveLimSw) {
+      bool level = ((levels >> motIdx) & 0x01);
+      if (level != p->limLevel) {
+        p->limLevel = level;
+        if ((uint16) (timeTicks - p->limChgTicks) >= 
+                       limActHyst(mSet[motIdx].val.limitSwCtl)) {
+          // last level was steady for hyst time
+          // curPos includes planned steps not output yet
+          struct stepState *s = &sState[motIdx];
+          int16 pos = p->curPos;
+          uint8 i;
+          for (i = s->stepQFire; i != (uint8) (s->stepQPlan + p->stepHeld); i++) {
+            pos -= p->stepQPosDelta[i & (STEP_Q_LEN - 1)];
+          }
+          p->limEdgeTicks = timeTicks;
+          p->limEdgePos   = pos;
+          if (p->probeState == PROBE_ARMED) {
+            p->probePos   = pos;
+            p->probeState = PROBE_HIT;
+          }
+        }
+        p->limChgTicks = timeTicks;
       }
-      ms1LAT = ((p->ustep & 0x01) ? 1 : 0);
-      ms2LAT = ((p->ustep & 0x02) ? 1 : 0);
-      dirLAT =   p->curDir        ? 1 : 0;
-      setBiStepHiInt(motIdx);
-      p->stepPending = false;
-      p->lastStepTicks = timeTicks;
-      p->stepped = true;
     }
   }
 }
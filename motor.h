@@ -6,20 +6,27 @@
 #include "types.h"
 #include "pins.h"
 
-#define NUM_MOTORS 4
-
 #define DEF_MCU_CLK 30
 
 // globals for use in main event loop
 extern uint8                   motorIdx;
 extern struct motorState      *ms;
+extern struct stepState       *ss;
 extern struct motorSettings   *sv;
 
-#define setBiStepLo()           *stepPort[motorIdx] &= ~stepMask[motorIdx]
-#define setBiStepHiInt(_motIdx) *stepPort[_motIdx]  |=  stepMask[_motIdx]
-#define resetIsLo()          ((*resetPort[motorIdx] &   resetMask[motorIdx]) == 0)
-#define setResetLo()           *resetPort[motorIdx] &= ~resetMask[motorIdx]
-#define setResetHi()           *resetPort[motorIdx] |=  resetMask[motorIdx]
+// pin ops by motor letter (A, B, ...) from pins.h, constant port and bit
+// so each is one bset, bclr, or btst instruction
+// forEachMotor and motorSwitch are generated in pins.h for the board
+#define stepPinHi(_m)   step##_m##LAT  = 1
+#define stepPinLo(_m)   step##_m##LAT  = 0
+#define resetPinHi(_m)  reset##_m##LAT = 1
+#define resetPinLo(_m)  reset##_m##LAT = 0
+#define resetPinIsLo(_m) (reset##_m##LAT == 0)
+#define faultPinIsLo(_m) ((fault##_m##PORT & fault##_m##BIT) == 0)
+#define limPinIsHi(_m)   ((lim##_m##PORT   & lim##_m##BIT)   != 0)
+
+#define setResetLo() motorSwitch(motorIdx, resetPinLo)
+#define setResetHi() motorSwitch(motorIdx, resetPinHi)
 
 extern bool haveSettings[NUM_MOTORS];
 
@@ -39,10 +46,22 @@ struct motorSettings {
   uint16 backlashWid;    // backlash dead width in steps
   uint16 maxUstep;       // maximum ustep (0 for 5-wire unipolar stepper, else 3)
   uint16 mcuClock;       // period of clock in usecs  (applies to all motors in mcu)
+  uint16 homingFastSpeed; // fast first approach to limit sw (0 for none)
+  uint16 homeRetain;      // keep homed state through reset when no steps lost
+  uint16 encRatio;        // 1/8 steps per encoder count * 256, 0: no encoder
+  uint16 encMaxErr;       // following error limit in 1/8 steps, 0: none
+  uint16 driftTol;        // home drift in 1/8 steps counted as step loss
 };
 
-#define mcuClockSettingIdx 13
-#define NUM_SETTING_WORDS  14
+#define accelSettingIdx       0
+#define homingDirSettingIdx   5
+#define homeOfsSettingIdx     8
+#define homePosSettingIdx     9
+#define limitSwCtlSettingIdx 10
+#define maxUstepSettingIdx   12
+#define mcuClockSettingIdx   13
+#define encRatioSettingIdx   16
+#define NUM_SETTING_WORDS  19
 
 #define LIM_ENBL_MASK        0x8000
 #define LIM_ACT_TIMEOUT_MASK 0x0f00
@@ -54,29 +73,31 @@ struct motorSettings {
 #define LIM_ACT_HYST_OFS     4
 #define LIM_POL_OFS          0
 
+// activity timeout and hysteresis in ticks, _lsc is limitSwCtl setting
+#define limActThres(_lsc) (((_lsc) & LIM_ACT_TIMEOUT_MASK) << (10-LIM_ACT_TIMEOUT_OFS))
+#define limActHyst(_lsc)  (((_lsc) & LIM_ACT_HYST_MASK)    << (5-LIM_ACT_HYST_OFS))
+
 union settingsUnion{
   uint16 reg[NUM_SETTING_WORDS];
   struct motorSettings val;
 };
 extern union settingsUnion mSet[NUM_MOTORS];
 
-extern volatile uint16 *stepPort[NUM_MOTORS];
-extern const    uint16  stepMask[NUM_MOTORS];
-
-extern volatile uint16 *resetPort[NUM_MOTORS];
-extern const    uint16  resetMask[NUM_MOTORS];
-
-extern volatile uint16 *faultPort[NUM_MOTORS];
-extern const    uint16  faultMask[NUM_MOTORS];
-
 void motorInit(void);
 void checkAll(void);
+bool resetIsLo(void);
 bool haveFault(void);
+bool limPinHi(uint8 motIdx);
 bool limitSwOn(void);
 void motorOn(void);
-void processCommand(void);
+void processCommand(volatile uint8 *rb);
 void clockInterrupt(void);
 void setNextStepTicks(uint16 ticks);
+void applySettings(void);
+void applySetting(uint8 idx);
+void commitStep(uint8 qIdx);
+void cancelSteps(void);
+int16 outputPos(void);
 
 #endif	/* MOTOR_H */
 
@@ -0,0 +1,162 @@
+/*
+  node /root/dev/p3/mcu-motors/move-planner.js dist maxSpeed maxAccelIdx [jerk] [mcuClock]
+*/
+
+fs = require('fs');
+
+// host utility to pick the accel-speed-move command (0x08) for a move
+// and predict when the move will be done
+
+// each step of the move is simulated the same way checkMotor() does it
+// using the same integer math, accelTable, jerk, dist table and ustep rules
+// so the predicted time matches the mcu, not an ideal trapezoid
+
+// all dist is in 1/8 steps, speed in 1/8 steps/sec, time in mcu clock ticks
+
+const accelTable = [0, 500, 1000, 2500, 5000, 10000, 25000, 50000];
+const uStepPhaseMask = [0x07, 0x03, 0x01, 0x00];
+const uStepDist = [8, 4, 2, 1];
+const MIN_USTEP = 0;
+
+// use the table actually compiled into the mcu
+const distTable = (() => {
+  let src = fs.readFileSync(__dirname + '/dist-table.c', 'utf8');
+  let body = src.slice(src.indexOf('disttable[2048] = {') + 19, src.lastIndexOf('}'));
+  let tab = body.split(',').map(s => s.trim()).filter(s => s.length).map(Number);
+  if (tab.length != 2048) throw new Error('dist table has ' + tab.length + ' entries');
+  return tab;
+})();
+
+const calcDist = (accelIdx, speed) => {
+  if (speed >= 0x8000) speed = 0x7fff;
+  return distTable[(accelIdx << 8) | (speed >> 7)];
+};
+
+// time of one move from rest to rest, same as checkMotor() with no queue
+// returns {ticks, steps, peakSpeed}
+const simMove = (dist, accelIdx, speed, opts = {}) => {
+  const jerk = opts.jerk ?? 4000;
+  const maxUstep = opts.maxUstep ?? 3;
+  const clkTicksPerSec = Math.floor(1000000 / (opts.mcuClock ?? 30)) & 0xffff;
+  const acceleration = accelTable[accelIdx];
+
+  let distRemaining = Math.abs(dist);
+  let curSpeed = jerk;
+  let ustep = opts.ustep ?? 3;
+  let phase = opts.phase ?? 0;
+  let slowing = false;
+  let ticks = 0, steps = 0, peakSpeed = 0;
+
+  while (distRemaining > 0) {
+    let accelerate = false, decelerate = false, closing = false;
+    if (distRemaining <= uStepDist[MIN_USTEP]) {
+      closing = true;
+    }
+    else if (accelIdx == 0) {
+      curSpeed = speed;
+    }
+    else {
+      if (curSpeed <= jerk) {
+        // can chg dir any time when slow
+      }
+      else if (slowing) {
+        decelerate = true;
+      }
+      else if (distRemaining < calcDist(accelIdx, curSpeed)) {
+        decelerate = true;
+        slowing = true;
+      }
+      if (!decelerate) {
+        if (curSpeed > speed) decelerate = true;
+        else if (!slowing && curSpeed < speed) accelerate = true;
+      }
+    }
+    if (decelerate) {
+      let deltaSpeed = Math.floor((acceleration * 8) / curSpeed) || 1;
+      curSpeed = (curSpeed >= deltaSpeed ? curSpeed - deltaSpeed : jerk);
+    }
+    else if (accelerate) {
+      let deltaSpeed = Math.floor((acceleration * 8) / curSpeed) || 1;
+      curSpeed = Math.min(curSpeed + deltaSpeed, speed);
+    }
+    if (!closing) {
+      let tgtUstep;
+      if (curSpeed > (8192 + 4096) / 2) tgtUstep = 0;
+      else if (curSpeed > (4096 + 2048) / 2) tgtUstep = 1;
+      else if (curSpeed > (2048 + 1024) / 2) tgtUstep = 2;
+      else tgtUstep = 3;
+      // you can only change ustep when the drv8825 phase is correct
+      if (tgtUstep != ustep && (phase & uStepPhaseMask[tgtUstep]) == 0) {
+        ustep = tgtUstep;
+      }
+    }
+    else {
+      // adjust ustep to hit exact position
+      while (ustep < 3 && uStepDist[ustep] > distRemaining) ustep++;
+    }
+    if (ustep > maxUstep) ustep = maxUstep;
+
+    // below 8 the ustep speed is under 1 and the mcu uses a 32-bit interval
+    if (curSpeed == 0) throw new Error('speed 0 never arrives');
+    let pps = curSpeed >> (3 - ustep);
+    if (pps) ticks += Math.floor(clkTicksPerSec / pps);
+    else ticks += Math.floor(clkTicksPerSec * (1 << (3 - ustep)) / curSpeed);
+    distRemaining -= uStepDist[ustep];
+    phase = (phase + uStepDist[ustep]) & 0x1f;
+    peakSpeed = Math.max(peakSpeed, curSpeed);
+    steps++;
+  }
+  return {ticks, steps, peakSpeed};
+};
+
+// pick accelIdx and speed within the axis limits that finish the move first
+// on a tie the lower accel and then the lower speed is used (easier on mechanics)
+// lower speeds are tried because the 128 (1/8 steps/sec) rows of the dist table
+// can make the mcu start decelerating early from the max speed
+const planMove = (dist, limits, opts = {}) => {
+  const maxSpeed = limits.maxSpeed;
+  const maxAccelIdx = limits.maxAccelIdx;
+  const jerk = opts.jerk ?? 4000;
+  let best = null;
+  const tryPlan = (accelIdx, speed) => {
+    let res = simMove(dist, accelIdx, speed, opts);
+    if (best == null || res.ticks < best.ticks ||
+        (res.ticks == best.ticks && accelIdx == best.accelIdx)) {
+      best = {accelIdx, speed, ...res};
+    }
+    return res;
+  };
+  for (let accelIdx = (maxAccelIdx == 0 ? 0 : 1); accelIdx <= maxAccelIdx; accelIdx++) {
+    let peak = tryPlan(accelIdx, maxSpeed).peakSpeed;
+    if (accelIdx == 0) continue;
+    for (let speed = Math.min(peak, maxSpeed - 1) & ~0x7f;
+         speed > jerk && speed >= peak - 2048; speed -= 128) {
+      tryPlan(accelIdx, speed);
+    }
+  }
+  best.usecs = best.ticks * (opts.mcuClock ?? 30);
+  return best;
+};
+
+// bytes of the accel-speed-move command, see interface-doc.txt
+const accelSpeedMoveCmd = (accelIdx, speed, pos) =>
+  [0x08 | accelIdx, (speed >> 8) & 0xff, speed & 0xff, (pos >> 8) & 0xff, pos & 0xff];
+
+module.exports = {simMove, planMove, accelSpeedMoveCmd, calcDist};
+
+if (require.main === module) {
+  let [dist, maxSpeed, maxAccelIdx, jerk, mcuClock] = process.argv.slice(2).map(Number);
+  if (isNaN(maxAccelIdx)) {
+    console.log('usage: node move-planner.js dist maxSpeed maxAccelIdx [jerk] [mcuClock]');
+    process.exit(1);
+  }
+  let opts = {};
+  if (!isNaN(jerk)) opts.jerk = jerk;
+  if (!isNaN(mcuClock)) opts.mcuClock = mcuClock;
+  let plan = planMove(dist, {maxSpeed, maxAccelIdx}, opts);
+  console.log('accelIdx:', plan.accelIdx, ' speed:', plan.speed,
+              ' peak speed:', plan.peakSpeed, ' steps:', plan.steps,
+              ' ticks:', plan.ticks, ' msecs:', (plan.usecs / 1000).toFixed(1));
+  console.log('cmd:', accelSpeedMoveCmd(plan.accelIdx, plan.speed, dist)
+              .map(b => '0x' + b.toString(16).padStart(2, '0')).join(' '));
+}
@@ -8,7 +8,9 @@
 #include "clock.h"
 #include "stop.h"
 #include "dist-table.h"
+#include "home.h"
 #include "debug.h"
+#include "sync.h"
 
 const uint16 uStepPhaseMask[4] = {0x07, 0x03, 0x01, 0x00};
 const uint16 uStepDist[4]      = {   8,    4,    2,    1};
@@ -18,13 +20,106 @@ const uint16 uStepDist[4]      = {   8,    4,    2,    1};
 const uint16 accelTable[8] = // (steps/sec/sec accel) / 8
        {0, 500, 1000, 2500, 5000, 10000, 25000, 50000};
 
+union moveSegQ moveQ[NUM_MOTORS];
+
+// arrived at current target, continue with next queued move
+void popQueuedMove() {
+  struct moveQEntry *e = &moveQ[motorIdx].move[ms->moveQHead];
+  ms->moveQHead   = (ms->moveQHead + 1) & (MOVE_Q_LEN - 1);
+  ms->moveQCount--;
+  ms->targetPos   = e->pos;
+  ms->targetSpeed = e->speed;
+  ms->targetDir   = (ms->targetPos >= ms->curPos);
+  ms->slowing     = false;
+  planJunctions();
+}
+
+// look-ahead over queued moves, done whenever queue changes
+// backward pass in decel-distance space so calcDist never has to be inverted
+// junctionDist is the decel dist still allowed when arriving at current target
+//   0 means arrive at jerk speed (end of queue or direction reversal)
+void planJunctions() {
+  uint16 dist  = 0;
+  uint8  dirs  = 0;  // bit i set if queued move i is forward
+  bool   dir   = ms->targetDir;
+  int16  pos   = ms->targetPos;
+  uint8  i;
+  for(i = 0; i < ms->moveQCount; i++) {
+    struct moveQEntry *e = &moveQ[motorIdx].move[(ms->moveQHead + i) & (MOVE_Q_LEN - 1)];
+    if(e->pos != pos) dir = (e->pos > pos);
+    if(dir) dirs |= (1 << i);
+    pos = e->pos;
+  }
+  i = ms->moveQCount;
+  while(i > 0) {
+    i--;
+    struct moveQEntry *e = &moveQ[motorIdx].move[(ms->moveQHead + i) & (MOVE_Q_LEN - 1)];
+    struct moveQEntry *prev;
+    bool   prevDir;
+    uint16 prevSpeed;
+    int16  prevPos;
+    if(i == 0) {
+      prevDir   = ms->targetDir;
+      prevPos   = ms->targetPos;
+      prevSpeed = ms->targetSpeed;
+    }
+    else {
+      prev      = &moveQ[motorIdx].move[(ms->moveQHead + i - 1) & (MOVE_Q_LEN - 1)];
+      prevDir   = ((dirs >> (i - 1)) & 1);
+      prevPos   = prev->pos;
+      prevSpeed = prev->speed;
+    }
+    if(((dirs >> i) & 1) != prevDir) {
+      // reversing at this junction, must be at jerk speed
+      dist = 0;
+      continue;
+    }
+    uint16 len   = (e->pos > prevPos ? e->pos - prevPos : prevPos - e->pos);
+    uint16 limit = calcDist(sv->accelIdx, 
+                     (e->speed < prevSpeed ? e->speed : prevSpeed));
+    uint32 d     = (uint32) dist + len;
+    dist = (d < limit ? d : limit);
+  }
+  ms->junctionDist = dist;
+}
+
+// give planned step to interrupt once it is due within STEP_HOLD_TICKS
+// until then it waits here, so a step interval can be any length
+void releaseStep() {
+  bool err;
+  disableAllInts;
+  int32 ahead = (int32) (ms->lastStepTicks - (extTicksInt() + 1));
+  err = (ahead < 0);
+  if(!err && ahead <= STEP_HOLD_TICKS) {
+    // interrupt owns entry now
+    ss->stepQPlan++;
+    ms->stepHeld = false;
+  }
+  enableAllInts;
+  if(err) { 
+    // step time is in the past, cancel undoes the held step
+    setError(STEP_NOT_DONE_ERROR); 
+  }
+}
+
 void checkMotor() {
   bool  accelerate = false;
   bool  decelerate = false;
   bool  closing    = false;
   
+  if(ms->stepHeld) {
+    // next step is planned, waiting until it is close enough to output
+    releaseStep();
+    return;
+  }
   if(ms->homing) {
-    if (sv->accelIdx == 0 || 
+    if(ms->homingState == homeFastSeek && sv->accelIdx && 
+       ms->curDir == ms->targetDir) {
+      // fast seek ramps like a normal move
+      if     (ms->curSpeed < ms->targetSpeed) accelerate = true;
+      else if(ms->curSpeed > ms->targetSpeed) decelerate = true;
+    }
+    else if (sv->accelIdx == 0 || 
         ms->curSpeed <= sv->jerk) {
       ms->curSpeed = ms->targetSpeed;
       ms->curDir   = ms->targetDir;
@@ -40,13 +135,19 @@ void checkMotor() {
     // normal move to target position
 
     int16 distRemaining = (ms->targetPos - ms->curPos);
+    while(distRemaining == 0 && ms->moveQCount) {
+      // passing through junction without stopping
+      // a waypoint at the current pos is passed too, not a stop
+      popQueuedMove();
+      distRemaining = (ms->targetPos - ms->curPos);
+    }
     bool  distRemPositive = (distRemaining >= 0);
     if(!distRemPositive) {
       distRemaining = -distRemaining;
     }
     if(distRemaining == 0) {
-      // finished normal move
-      stopStepping();
+      // finished normal move when last planned steps are output
+      if(stepsPlanned(ss) == 0) stopStepping();
       return;
     }
     if(distRemaining <= uStepDist[MIN_USTEP]) {
@@ -68,8 +169,8 @@ void checkMotor() {
           // going slower than accel threshold
           
           if(ms->curPos == ms->targetPos) {
-            // finished normal move
-            stopStepping();
+            // finished normal move when last planned steps are output
+            if(stepsPlanned(ss) == 0) stopStepping();
             return;
           }
           // can chg dir any time when slow
@@ -87,8 +188,9 @@ void checkMotor() {
           }
           else {
             // look up decel dist target
+            // queued moves after this one may allow arriving faster
             uint16 distTgt = calcDist(sv->accelIdx, ms->curSpeed);
-            if(distRemaining < distTgt) {
+            if((uint32) distRemaining + ms->junctionDist < distTgt) {
               decelerate = true;
               ms->slowing = true;
             }
@@ -127,7 +229,6 @@ void checkMotor() {
       ms->curSpeed = ms->targetSpeed;
     }
   }
-  uint16 clkTicks;
   if(!closing) {
     // adjust ustep
     uint8 tgtUstep;
@@ -155,48 +256,46 @@ void checkMotor() {
       ms->ustep++;
     }
   }
-  if(ms->ustep > mSet->val.maxUstep) {
-     ms->ustep = mSet->val.maxUstep;
-  }
-  // set step timing
-  switch (ms->ustep) {
-    case 0:  clkTicks = clkTicksPerSec / (ms->curSpeed >> 3); break;
-    case 1:  clkTicks = clkTicksPerSec / (ms->curSpeed >> 2); break;
-    case 2:  clkTicks = clkTicksPerSec / (ms->curSpeed >> 1); break;
-    case 3:  clkTicks = clkTicksPerSec /  ms->curSpeed      ; break;
-    default: clkTicks = 0; // to avoid compiler warning
+  if(ms->ustep > sv->maxUstep) {
+     ms->ustep = sv->maxUstep;
   }
+  // set step timing, speed is in 1/8 steps per sec
+  // below 8 the ustep speed is under 1 and the interval needs 32 bits
+  uint32 clkTicks;
+  uint16 ustepSpeed = ms->curSpeed >> (3 - ms->ustep);
+  if(ustepSpeed) clkTicks = clkTicksPerSec / ustepSpeed;
+  else clkTicks = ((uint32) clkTicksPerSec << (3 - ms->ustep)) / ms->curSpeed;
 
-  bool err;
-  disableAllInts;
-  ms->nextStepTicks = ms->lastStepTicks + clkTicks;
-  // modulo 2**16 arithmetic
-  err = (ms->nextStepTicks - (timeTicks+1)) > 32000;
-  enableAllInts;
-  ms->stepped = false;
-  if(err) { 
-    // nextStepTicks is in the past
-    setError(STEP_NOT_DONE_ERROR); 
-  } else {
-    setBiStepLo();
-    ms->stepPending = true;
-  }
+  // plan step while earlier steps may still be waiting for output
+  uint8  qIdx  = ss->stepQPlan & (STEP_Q_LEN - 1);
+  uint32 ticks = ms->lastStepTicks + clkTicks;
+  ss->stepQTicks[qIdx] = ticks;   // bottom 16 bits
+  ss->stepQCtl[qIdx]   = ms->ustep | (ms->curDir ? STEP_DIR_BIT : 0);
+  commitStep(qIdx);
+  ms->lastStepTicks = ticks;
+  ms->stepHeld      = true;
+  releaseStep();
 }
 
+
 void moveCommand(bool noRules) {
   ms->noBounds = noRules;
+  if(ss->segMode) stopStepping();
   
   if((ms->stateByte & HOMED_BIT) == 0 && !noRules) {
     setError(NOT_HOMED);
     return;
   }
-  ms->slowing     = false;
-  ms->homing      = false;
-  ms->stopping    = false;
-  ms->targetDir   = (ms->targetPos >= ms->curPos);   
+  ms->slowing      = false;
+  ms->homing       = false;
+  ms->stopping     = false;
+  ms->moveQCount   = 0;     // immediate move replaces any queued moves
+  ms->probeState   = PROBE_IDLE;
+  ms->junctionDist = 0;
+  ms->targetDir    = (ms->targetPos >= ms->curPos);   
   if(ms->curSpeed == 0 || (ms->stateByte & BUSY_BIT) == 0) {
     disableAllInts;
-    ms->lastStepTicks = timeTicks;
+    ms->lastStepTicks = moveStartTicks();
     enableAllInts;
     ms->curSpeed = sv->jerk;
     ms->curDir   = ms->targetDir;
@@ -204,5 +303,93 @@ void moveCommand(bool noRules) {
   setStateBit(BUSY_BIT, 1);
 }
 
+// add waypoints to end of queue, first starts immediately when not already moving
+// wp is count 4-byte waypoints (speed, pos), all are queued or none
+void pathCommand(volatile uint8 *wp, uint8 count) {
+  uint8 i;
+  for(i = 0; i < count; i++) {
+    if(wp[i*4] == 0 && wp[i*4 + 1] == 0) {
+      // speed 0 would never arrive
+      setError(CMD_DATA_ERROR);
+      return;
+    }
+  }
+  // segments share the queue bytes, so a path replaces them
+  bool  startNow = ((ms->stateByte & BUSY_BIT) == 0 || ss->segMode ||
+                     ms->homing || ms->stopping || ms->noBounds);
+  uint8 queued   = (startNow ? count - 1 : ms->moveQCount + count);
+  if(queued > MOVE_Q_LEN) {
+    setError(OVERFLOW_ERROR);
+    return;
+  }
+  if(startNow) {
+    ms->targetSpeed = ((uint16) wp[0] << 8) | wp[1];
+    ms->targetPos   = (int16) (((uint16) wp[2] << 8) | wp[3]);
+    moveCommand(false);
+    if((ms->stateByte & BUSY_BIT) == 0) return;  // not homed
+    wp += 4;
+    count--;
+  }
+  while(count--) {
+    struct moveQEntry *e = 
+          &moveQ[motorIdx].move[(ms->moveQHead + ms->moveQCount) & (MOVE_Q_LEN - 1)];
+    e->speed = ((uint16) wp[0] << 8) | wp[1];
+    e->pos   = (int16) (((uint16) wp[2] << 8) | wp[3]);
+    ms->moveQCount++;
+    wp += 4;
+  }
+  // one look-ahead for the whole path
+  planJunctions();
+}
 
+// add host segment to end of segment queue
+// starts stepping from now when motor is not already stepping segments
+void segmentCommand(uint16 interval, uint16 count, int16 add, uint8 ctl) {
+  // step pin is low for a whole tick between steps, so interval is at least 2
+  // interval changes linearly, so first and last step are the extremes
+  int32 last = (int32) interval + (int32) (count - 1) * add;
+  if(interval < 2 || interval > 32767 || count == 0 ||
+     last < 2 || last > 32767 || (ctl & ~(STEP_DIR_BIT | 0x03)) ||
+     (ctl & 0x03) > sv->maxUstep) {
+    setError(CMD_DATA_ERROR);
+    return;
+  }
+  if(!ss->segMode || !segsActive(ss)) {
+    // new sequence
+    if(ms->stateByte & BUSY_BIT) stopStepping();
+    ms->probeState = PROBE_IDLE;
+    disableAllInts;
+    ss->segTicks = moveStartTicks();
+    enableAllInts;
+  }
+  uint8 tail = (ss->segQTail + 1) & (SEG_Q_LEN - 1);
+  if(tail == ss->segQHead) {
+    setError(OVERFLOW_ERROR);
+    return;
+  }
+  struct stepSeg *s = &moveQ[motorIdx].seg[ss->segQTail];
+  s->interval = interval;
+  s->count    = count;
+  s->add      = add;
+  s->ctl      = ctl;
+  // interrupt owns entry now
+  ss->segQTail = tail;
+  ss->segMode  = true;
+  setStateBit(BUSY_BIT, 1);
+}
 
+// move toward pos until limit switch changes, then soft stop
+void probeCommand(int16 pos, uint16 speed) {
+  if(!ms->haveLimSw || speed == 0) {
+    setError(CMD_DATA_ERROR);
+    return;
+  }
+  ms->targetPos   = pos;
+  ms->targetSpeed = speed;
+  moveCommand(false);
+  if((ms->stateByte & BUSY_BIT) && !haveError()) {
+    disableAllInts;
+    ms->probeState = PROBE_ARMED;
+    enableAllInts;
+  }
+}
@@ -4,17 +4,49 @@
 #include <xc.h>
 #include "types.h"
 #include "motor.h"
+#include "state.h"
 
 // only 1/1 -> 1/8 ustep allowed 
 // MS3 can be wired low in boards
 #define MIN_USTEP 0
 #define MAX_USTEP 3
+// phase cycle in drv8825 is 4 full steps (32 1/8 steps)
+#define PHASE_CYCLE_MASK 0x1f
 extern const uint16 uStepPhaseMask[4];
 extern const uint16 uStepDist[4];
 extern const uint16 accelTable[8];
 
+// queued moves, executed back to back without stopping at each target
+// RECV_BUF_SIZE fits a path cmd of up to MOVE_Q_LEN + 1 waypoints
+#define MOVE_Q_LEN 4  // must be power of 2, at most 8 (junction dir bits)
+
+struct moveQEntry {
+  int16  pos;
+  uint16 speed;
+};
+
+// a motor either steps host segments or runs queued moves, never both
+// (a move clears the segments, a segment clears the moves)
+// so the two queues share the same bytes
+union moveSegQ {
+  struct moveQEntry move[MOVE_Q_LEN];
+  struct stepSeg    seg[SEG_Q_LEN];   // interrupt only reads when loading next seg
+};
+extern union moveSegQ moveQ[NUM_MOTORS];
+
+// probe states
+#define PROBE_IDLE   0
+#define PROBE_ARMED  1  // moving, waiting for limit sw to change
+#define PROBE_HIT    2  // switch changed, probePos latched in interrupt
+#define PROBE_DONE   3  // stopping or stopped after hit
+#define PROBE_MISSED 4  // stopped without switch change
+
 void checkMotor(void);
 void moveCommand(bool noRules);
+void pathCommand(volatile uint8 *wp, uint8 count);
+void probeCommand(int16 pos, uint16 speed);
+void segmentCommand(uint16 interval, uint16 count, int16 add, uint8 ctl);
+void planJunctions(void);
 
 #endif	/* MOVE_H */
 
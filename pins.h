@@ -1,4 +1,6 @@
-  
+// generated by pins_calc-C.js from board-p3.js (eridien P3, PIC24F16KM202)
+// edit the board file and run it again, do not edit this file
+
 #ifndef PINS_H
 #define	PINS_H
 
@@ -7,16 +9,25 @@
 #define I2C_BUF_BYTE  SSP1BUF
 #define I2C_SSPIF     SSP1IF
 
-#define IDTRIS    _TRISB1   // mcu ID, sets i2c base addr
-#define IDPORT    _RB1     // 0: mcuA, 1: mcuB, only valid at startup
+#define NUM_MOTORS 4
+
+// motor idx is bottom I2C_MOTOR_BITS of 7-bit addr
+// I2C_ADDR_n is 8-bit form (7-bit addr << 1), picked by id pin
+#define I2C_MOTOR_BITS 2
+#define I2C_ADDR_MASK 0xf8
+#define I2C_ADDR_0 0x08         // mcuA, real addr: 0x04+motor
+#define I2C_ADDR_1 0x10         // mcuB, real addr: 0x08+motor
+
+#define IDTRIS     _TRISB1      // mcu ID, sets i2c base addr
+#define IDPORT     _RB1         // 0: mcuA, 1: mcuB, only valid at startup
 
-#define dirTRIS   _TRISA6
-#define ms1TRIS   _TRISA7
-#define ms2TRIS   _TRISB7
+#define dirTRIS    _TRISA6
+#define ms1TRIS    _TRISA7
+#define ms2TRIS    _TRISB7
 
-#define dirLAT    _LATA6
-#define ms1LAT    _LATA7
-#define ms2LAT    _LATB7
+#define dirLAT     _LATA6
+#define ms1LAT     _LATA7
+#define ms2LAT     _LATB7
 
 #define resetATRIS _TRISB15
 #define resetBTRIS _TRISB14
@@ -28,15 +39,15 @@
 #define resetCLAT  _LATB13
 #define resetDLAT  _LATB12
 
-#define resetAPORT  PORTB
-#define resetBPORT  PORTB
-#define resetCPORT  PORTB
-#define resetDPORT  PORTB
+#define resetAPORT PORTB
+#define resetBPORT PORTB
+#define resetCPORT PORTB
+#define resetDPORT PORTB
 
-#define resetABIT   0x8000
-#define resetBBIT   0x4000
-#define resetCBIT   0x2000
-#define resetDBIT   0x1000
+#define resetABIT  0x8000
+#define resetBBIT  0x4000
+#define resetCBIT  0x2000
+#define resetDBIT  0x1000
 
 #define stepATRIS  _TRISB1
 #define stepBTRIS  _TRISB2
@@ -58,56 +69,100 @@
 #define stepCBIT   0x0008
 #define stepDBIT   0x0004
 
-#define faultATRIS  _TRISA3
-#define faultBTRIS  _TRISB4
-#define faultCTRIS  _TRISA4
-#define faultDTRIS  _TRISB5
+#define faultATRIS _TRISA3
+#define faultBTRIS _TRISB4
+#define faultCTRIS _TRISA4
+#define faultDTRIS _TRISB5
 
 #define faultALAT  _LATA3
 #define faultBLAT  _LATB4
 #define faultCLAT  _LATA4
 #define faultDLAT  _LATB5
 
-#define faultAPORT  PORTA
-#define faultBPORT  PORTB
-#define faultCPORT  PORTA
-#define faultDPORT  PORTB
-
-#define faultABIT   0x0008
-#define faultBBIT   0x0010
-#define faultCBIT   0x0010
-#define faultDBIT   0x0020
-
-#define limALAT   _LATA0
-#define limBLAT   _LATA1
-#define limCLAT   _LATB0
-#define limDLAT   _LATB6
-
-#define limATRIS  _TRISA0
-#define limBTRIS  _TRISA1
-#define limCTRIS  _TRISB0
-#define limDTRIS  _TRISB6
-
-#define limAPORT  PORTA
-#define limBPORT  PORTB
-#define limCPORT  PORTB
-#define limDPORT  PORTA
-
-#define limABIT   0x0001
-#define limBBIT   0x0001
-#define limCBIT   0x0040
-#define limDBIT   0x0002
+#define faultAPORT PORTA
+#define faultBPORT PORTB
+#define faultCPORT PORTA
+#define faultDPORT PORTB
+
+#define faultABIT  0x0008
+#define faultBBIT  0x0010
+#define faultCBIT  0x0010
+#define faultDBIT  0x0020
+
+#define limATRIS   _TRISA0
+#define limBTRIS   _TRISB0
+#define limCTRIS   _TRISB6
+#define limDTRIS   _TRISA1
+
+#define limALAT    _LATA0
+#define limBLAT    _LATB0
+#define limCLAT    _LATB6
+#define limDLAT    _LATA1
+
+#define limAPORT   PORTA
+#define limBPORT   PORTB
+#define limCPORT   PORTB
+#define limDPORT   PORTA
+
+#define limACNIE   _CN2IE
+#define limBCNIE   _CN4IE
+#define limCCNIE   _CN24IE
+#define limDCNIE   _CN3IE
+
+#define limABIT    0x0001
+#define limBBIT    0x0001
+#define limCBIT    0x0040
+#define limDBIT    0x0002
+
+// quadrature encoders, channels A and B
+#define encAATRIS  _TRISB10
+#define encAAPORT  PORTB
+#define encAACNIE  _CN16IE
+#define encAABIT   0x0400
+
+#define encABTRIS  _TRISB11
+#define encABPORT  PORTB
+#define encABCNIE  _CN15IE
+#define encABBIT   0x0800
+
+// motors with an encoder, bit per motor
+#define ENC_MOTOR_MASK 0x01
+
+// runs _op(motor letter, motor idx) for every motor
+#define forEachMotor(_op) _op(A,0) _op(B,1) _op(C,2) _op(D,3)
+
+// runs _op(motor letter, motor idx) for every motor with an encoder
+#define forEachEnc(_op) _op(A,0)
+
+// runs _op(motor letter) for the letter of motor idx
+// a constant idx folds to the one op, else it is a jump table
+#define motorSwitch(_idx, _op) switch(_idx) { \
+    case 0:  _op(A); break;                   \
+    case 1:  _op(B); break;                   \
+    case 2:  _op(C); break;                   \
+    default: _op(D); break;                   \
+  }
+
+// port and mask tables, for code that picks a pin by idx at run time
+#define LIM_PORTS  {&limAPORT, &limBPORT, &limCPORT, &limDPORT}
+#define LIM_MASKS  {limABIT, limBBIT, limCBIT, limDBIT}
+#define FAULT_PORTS {&faultAPORT, &faultBPORT, &faultCPORT, &faultDPORT}
+#define FAULT_MASKS {faultABIT, faultBBIT, faultCBIT, faultDBIT}
+#define ENC_A_PORTS {&encAAPORT, 0, 0, 0}
+#define ENC_A_MASKS {encAABIT, 0, 0, 0}
+#define ENC_B_PORTS {&encABPORT, 0, 0, 0}
+#define ENC_B_MASKS {encABBIT, 0, 0, 0}
 
 #ifdef DEBUG
-#define tp1TRIS faultATRIS
-#define tp2TRIS faultBTRIS
-#define tp3TRIS faultCTRIS
-#define tp4TRIS faultDTRIS
+#define tp1TRIS    faultATRIS
+#define tp2TRIS    faultBTRIS
+#define tp3TRIS    faultCTRIS
+#define tp4TRIS    faultDTRIS
 
-#define tp1LAT  faultALAT
-#define tp2LAT  faultBLAT
-#define tp3LAT  faultCLAT
-#define tp4LAT  faultDLAT
+#define tp1LAT      faultALAT
+#define tp2LAT      faultBLAT
+#define tp3LAT      faultCLAT
+#define tp4LAT      faultDLAT
 
 #define dbg10 tp1LAT = 0;
 #define dbg11 tp1LAT = 1;
@@ -120,4 +175,3 @@
 #endif
 
 #endif	/* PINS_H */
-
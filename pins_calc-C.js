@@ -0,0 +1,199 @@
+/*
+  node /root/dev/p3/mcu-motors/pins_calc-C.js [board file, default board-p3.js]
+*/
+
+fs = require('fs');
+
+// js utility to generate pins.h from a board description
+// pins.h has the pin names the C code uses for each motor (stepALAT, limBPORT, ...),
+// the motor count, the i2c addr scheme, and per-motor expansion macros
+// so the C code never hard-codes how many motors there are
+
+const boardFile = process.argv[2] || 'board-p3.js';
+const board = require(require('path').resolve(__dirname, boardFile));
+
+const fail = (msg) => {
+  console.log(boardFile + ': ' + msg);
+  process.exit(1);
+};
+
+// 'RB15' -> {port: 'B', bit: 15}
+const pin = (name, what) => {
+  let m = /^R([A-Z])(\d+)$/.exec(name || '');
+  if (!m || m[2] > 15) fail('bad pin "' + name + '" for ' + what);
+  return {port: m[1], bit: +m[2], name};
+};
+
+const hex = (n, digits) => '0x' + n.toString(16).padStart(digits, '0');
+
+const numMotors = board.motors.length;
+if (numMotors < 1 || numMotors > 8) fail('1 to 8 motors, masks are one byte');
+const letters = board.motors.map((m, i) => String.fromCharCode(65 + i));
+
+// motor idx is the bottom bits of the 7-bit addr
+let motorBits = 0;
+while ((1 << motorBits) < numMotors) motorBits++;
+if (board.mcus.length < 1 || board.mcus.length > 2) fail('1 or 2 mcus, id pin is one bit');
+board.mcus.forEach((mcu, i) => {
+  if (mcu.addr & ((1 << motorBits) - 1)) fail(mcu.name + ' addr must be multiple of ' + (1 << motorBits));
+  if (mcu.addr == 0) fail(mcu.name + ' addr 0 is general call');
+  if (mcu.addr + (1 << motorBits) > 0x78) fail(mcu.name + ' addr is reserved');
+  if (i && (mcu.addr >> motorBits) == (board.mcus[0].addr >> motorBits)) fail('mcus share addrs');
+});
+const addrMask = (0xff << (motorBits + 1)) & 0xff;
+
+// no pin used twice, except the id pin which is read before it is an output
+let used = {};
+const usePin = (name, what) => {
+  let p = pin(name, what);
+  if (used[name]) fail(name + ' is ' + used[name] + ' and ' + what);
+  used[name] = what;
+  return p;
+};
+pin(board.idPin, 'id');
+const dir = usePin(board.dirPin, 'dir');
+const ms1 = usePin(board.ms1Pin, 'ms1');
+const ms2 = usePin(board.ms2Pin, 'ms2');
+const motors = board.motors.map((m, i) => {
+  const l = letters[i];
+  if (!(m.limCN >= 0)) fail('motor ' + l + ' needs limCN');
+  let mot = {l, cn: m.limCN,
+    step:  usePin(m.step,  'step'  + l),
+    reset: usePin(m.reset, 'reset' + l),
+    fault: usePin(m.fault, 'fault' + l),
+    lim:   usePin(m.lim,   'lim'   + l)};
+  // optional quadrature encoder, both channels on change notice pins
+  if (m.encA || m.encB) {
+    if (!(m.encACN >= 0 && m.encBCN >= 0)) fail('motor ' + l + ' needs encACN and encBCN');
+    mot.encA = usePin(m.encA, 'enc' + l + 'A');
+    mot.encB = usePin(m.encB, 'enc' + l + 'B');
+    mot.encACN = m.encACN;
+    mot.encBCN = m.encBCN;
+  }
+  return mot;
+});
+const encMotors = motors.filter(m => m.encA);
+
+let out = [];
+const line = (s = '') => out.push(s);
+const def = (name, val, comment) => {
+  let s = '#define ' + name.padEnd(10) + ' ' + val;
+  if (comment) s = s.padEnd(32) + '// ' + comment;
+  line(s);
+};
+const pinDefs = (what, key, withCN) => {
+  motors.forEach(m => def(what + m.l + 'TRIS', '_TRIS' + m[key].port + m[key].bit));
+  line();
+  motors.forEach(m => def(what + m.l + 'LAT',  '_LAT'  + m[key].port + m[key].bit));
+  line();
+  motors.forEach(m => def(what + m.l + 'PORT', 'PORT'  + m[key].port));
+  line();
+  if (withCN) {
+    motors.forEach(m => def(what + m.l + 'CNIE', '_CN' + m.cn + 'IE'));
+    line();
+  }
+  motors.forEach(m => def(what + m.l + 'BIT',  hex(1 << m[key].bit, 4)));
+  line();
+};
+const table = (name, fn) => def(name, '{' + motors.map(fn).join(', ') + '}');
+
+line('// generated by pins_calc-C.js from ' + boardFile +
+     ' (' + board.name + ', ' + board.part + ')');
+line('// edit the board file and run it again, do not edit this file');
+line();
+line('#ifndef PINS_H');
+line('#define\tPINS_H');
+line();
+line('#define I2C_START_BIT SSP1STATbits.S');
+line('#define I2C_STOP_BIT  SSP1STATbits.P');
+line('#define I2C_BUF_BYTE  SSP1BUF');
+line('#define I2C_SSPIF     SSP1IF');
+line();
+line('#define NUM_MOTORS ' + numMotors);
+line();
+line('// motor idx is bottom I2C_MOTOR_BITS of 7-bit addr');
+line('// I2C_ADDR_n is 8-bit form (7-bit addr << 1), picked by id pin');
+def('I2C_MOTOR_BITS', motorBits);
+def('I2C_ADDR_MASK', hex(addrMask, 2));
+board.mcus.forEach((mcu, i) =>
+  def('I2C_ADDR_' + i, hex(mcu.addr << 1, 2), mcu.name + ', real addr: ' + hex(mcu.addr, 2) + '+motor'));
+if (board.mcus.length == 1) def('I2C_ADDR_1', 'I2C_ADDR_0', 'one mcu, id pin ignored');
+line();
+const id = pin(board.idPin, 'id');
+def('IDTRIS', '_TRIS' + id.port + id.bit, 'mcu ID, sets i2c base addr');
+def('IDPORT', '_R' + id.port + id.bit, '0: ' + board.mcus[0].name +
+    (board.mcus[1] ? ', 1: ' + board.mcus[1].name : '') + ', only valid at startup');
+line();
+def('dirTRIS', '_TRIS' + dir.port + dir.bit);
+def('ms1TRIS', '_TRIS' + ms1.port + ms1.bit);
+def('ms2TRIS', '_TRIS' + ms2.port + ms2.bit);
+line();
+def('dirLAT', '_LAT' + dir.port + dir.bit);
+def('ms1LAT', '_LAT' + ms1.port + ms1.bit);
+def('ms2LAT', '_LAT' + ms2.port + ms2.bit);
+line();
+pinDefs('reset', 'reset');
+pinDefs('step',  'step');
+pinDefs('fault', 'fault');
+pinDefs('lim',   'lim', true);
+
+if (encMotors.length) {
+  line('// quadrature encoders, channels A and B');
+  ['A', 'B'].forEach(ch => {
+    encMotors.forEach(m => {
+      let p = m['enc' + ch];
+      def('enc' + m.l + ch + 'TRIS', '_TRIS' + p.port + p.bit);
+      def('enc' + m.l + ch + 'PORT', 'PORT' + p.port);
+      def('enc' + m.l + ch + 'CNIE', '_CN' + m['enc' + ch + 'CN'] + 'IE');
+      def('enc' + m.l + ch + 'BIT',  hex(1 << p.bit, 4));
+    });
+    line();
+  });
+}
+line('// motors with an encoder, bit per motor');
+def('ENC_MOTOR_MASK', hex(motors.reduce((mask, m, i) => mask | (m.encA ? 1 << i : 0), 0), 2));
+line();
+
+line('// runs _op(motor letter, motor idx) for every motor');
+line('#define forEachMotor(_op) ' + motors.map((m, i) => '_op(' + m.l + ',' + i + ')').join(' '));
+line();
+line('// runs _op(motor letter, motor idx) for every motor with an encoder');
+line('#define forEachEnc(_op) ' + encMotors.map(m => '_op(' + m.l + ',' + motors.indexOf(m) + ')').join(' '));
+line();
+line('// runs _op(motor letter) for the letter of motor idx');
+line('// a constant idx folds to the one op, else it is a jump table');
+line('#define motorSwitch(_idx, _op) switch(_idx) { \\');
+motors.forEach((m, i) => {
+  let c = (i == numMotors - 1 ? 'default: ' : ('case ' + i + ':').padEnd(9));
+  line(('    ' + c + '_op(' + m.l + '); break;').padEnd(46) + '\\');
+});
+line('  }');
+line();
+line('// port and mask tables, for code that picks a pin by idx at run time');
+table('LIM_PORTS',   m => '&lim'   + m.l + 'PORT');
+table('LIM_MASKS',   m =>  'lim'   + m.l + 'BIT');
+table('FAULT_PORTS', m => '&fault' + m.l + 'PORT');
+table('FAULT_MASKS', m =>  'fault' + m.l + 'BIT');
+table('ENC_A_PORTS', m => (m.encA ? '&enc' + m.l + 'APORT' : '0'));
+table('ENC_A_MASKS', m => (m.encA ?  'enc' + m.l + 'ABIT'  : '0'));
+table('ENC_B_PORTS', m => (m.encA ? '&enc' + m.l + 'BPORT' : '0'));
+table('ENC_B_MASKS', m => (m.encA ?  'enc' + m.l + 'BBIT'  : '0'));
+line();
+
+// test points on the fault inputs of the first motors
+const tps = motors.slice(0, 4);
+line('#ifdef DEBUG');
+tps.forEach((m, i) => def('tp' + (i + 1) + 'TRIS', 'fault' + m.l + 'TRIS'));
+line();
+tps.forEach((m, i) => def('tp' + (i + 1) + 'LAT', ' fault' + m.l + 'LAT'));
+line();
+tps.forEach((m, i) => {
+  line('#define dbg' + (i + 1) + '0 tp' + (i + 1) + 'LAT = 0;');
+  line('#define dbg' + (i + 1) + '1 tp' + (i + 1) + 'LAT = 1;');
+});
+line('#endif');
+line();
+line('#endif\t/* PINS_H */');
+
+fs.writeFileSync(__dirname + '/pins.h', out.join('\n') + '\n');
+console.log('pins.h:', numMotors, 'motors,', board.mcus.length, 'mcus');
@@ -0,0 +1,40 @@
+/*
+  node /root/dev/p3/mcu-motors/ram-budget.js [map file, default dist/mcuA/production/mcu-motors.production.map]
+*/
+
+fs = require('fs');
+
+// js utility to check the xc16 map file against the ram budget
+// the linker gives the stack all ram left after static data
+// the stack must hold the deepest event loop calls plus one interrupt
+// (interrupts don't nest), about 90 bytes at -O0, so STACK_RESERVE
+// is also the linker's --stack option and a build that doesn't fit fails to link
+// this shows how close the build is, check the production map,
+// a debug build loses another 80 bytes to the debugger (0x800-0x84f)
+
+const RAM_BYTES     = 1024;  // pic24f16km202
+const STACK_RESERVE = 96;    // --stack in nbproject/configurations.xml
+const STACK_GUARD   = 16;    // --stackguard
+
+const mapFile = process.argv[2] || 'dist/mcuA/production/mcu-motors.production.map';
+const map = fs.readFileSync(mapFile, 'utf8');
+
+const fail = (msg) => {
+  console.log(mapFile + ': ' + msg);
+  process.exit(1);
+};
+
+// "Total data memory used (bytes):          0x386  (902) 88%"
+let m = /Total data memory used \(bytes\):\s+0x[0-9a-f]+\s+\((\d+)\)/i.exec(map);
+if (!m) fail('no data memory total, link with --report-mem');
+const dataBytes = +m[1];
+
+// "stack    0xb86    0x7a  (122)" in dynamic memory usage
+m = /^\s*stack\s+0x[0-9a-f]+\s+0x[0-9a-f]+\s+\((\d+)\)/im.exec(map);
+const stackBytes = (m ? +m[1] : RAM_BYTES - dataBytes - STACK_GUARD);
+
+console.log('static data:', dataBytes, 'bytes');
+console.log('stack:      ', stackBytes, 'bytes (reserve', STACK_RESERVE + ')');
+console.log('spare:      ', stackBytes - STACK_RESERVE, 'bytes');
+if (stackBytes < STACK_RESERVE) fail('over ram budget by ' +
+                                     (STACK_RESERVE - stackBytes) + ' bytes');
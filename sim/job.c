@@ -0,0 +1,294 @@
+/*
+  cycle-time sim, runs a job of host commands against one simulated mcu
+  build, see sim.c
+  run
+    sim/cycle-sim job.txt [i2c kHz, default 400]
+
+  job file, one item per line, # starts a comment, motors are A-D
+    config items in sim.c (mcu, start, switch, loop, stall)
+    poll   ms               host status poll period while waiting (default 2)
+    cmd    time m bytes     i2c write of hex bytes (e.g. 08 1f 40 0f a0)
+    wait   time ms          host polls motors ms (e.g. AB) until not busy,
+                            with no timed cmds (0x1c) left to start
+                            and no eeprom save or clear (0x18, 0x19) left
+    go     time             i2c general call go, starts armed cmds (0x11)
+    reset  time             mcu reset, settings are loaded from eeprom
+    eeprom time m word hex  overwrite word of motor's eeprom block, word is
+                            0 (version), settings idx + 1, or last (crc)
+  time is ms from start of job, or +ms after previous cmd or wait finished
+
+  reported
+    per cmd: when sent and when motor went idle after it (or was given a new cmd)
+    per go: when sent and when the last motor it started went idle
+    cycle time, i2c bus use, errors seen in state bytes
+    smallest step lead: ticks from when a step was planned to when it is due
+    a lead near zero means a slower event loop pass would miss the step
+    (STEP_NOT_DONE_ERROR), use loop n > 1 to see the effect of slower passes
+*/
+
+#include <xc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "types.h"
+#include "motor.h"
+#include "state.h"
+#include "i2c.h"
+#include "sync.h"
+#include "eeprom.h"
+#include "sim.h"
+
+extern uint16 eeSettings[NUM_MOTORS][EE_BLOCK_WORDS];
+
+#define MAX_LINES    1000
+#define MAX_CMD_LEN  (SET_BUF_SIZE)
+
+enum lineType {lineCmd, lineWait, lineGo, lineReset, lineEeprom};
+
+struct jobLine {
+  uint8  type;
+  int    srcLine;
+  bool   relTime;
+  double timeMs;
+  uint8  motMask;                 // wait: motors to wait for
+  uint8  motIdx;                  // cmd: motor written to
+  uint8  bytes[MAX_CMD_LEN];
+  uint8  numBytes;
+  uint8  eeWord;                  // eeprom: word idx in block and new value
+  uint16 eeVal;
+  double sentMs;                  // when cmd packet was done, or wait started
+  double doneMs;                  // when motor idle after cmd, or wait ended
+  bool   replaced;                // cmd: motor got another cmd before idle
+};
+
+struct jobLine job[MAX_LINES];
+int numJobLines;
+
+int    pendLine[NUM_MOTORS];    // cmd waiting for motor to be idle, -1 none
+bool   pendSeenBusy[NUM_MOTORS];
+
+double pollMs = 2;
+
+void parseTime(struct jobLine *j, char *s) {
+  if(s == 0) fail(j->srcLine, "missing time");
+  j->relTime = (s[0] == '+');
+  j->timeMs  = atof(s + j->relTime);
+}
+
+void readJob(char *path) {
+  FILE *f = fopen(path, "r");
+  if(f == 0) { perror(path); exit(1); }
+  char buf[512];
+  int  srcLine = 0;
+  while(fgets(buf, sizeof(buf), f)) {
+    srcLine++;
+    char *c = strchr(buf, '#');
+    if(c) *c = 0;
+    char *word = strtok(buf, " \t\r\n");
+    if(word == 0 || simConfigItem(word, srcLine)) continue;
+    if(!strcmp(word, "poll")) pollMs = atof(strtok(0, " \t\r\n") ?: "2");
+    else if(!strcmp(word, "go") || !strcmp(word, "reset")) {
+      if(numJobLines == MAX_LINES) fail(srcLine, "too many lines");
+      struct jobLine *j = &job[numJobLines++];
+      memset(j, 0, sizeof(*j));
+      j->srcLine = srcLine;
+      j->type    = (word[0] == 'g' ? lineGo : lineReset);
+      parseTime(j, strtok(0, " \t\r\n"));
+    }
+    else if(!strcmp(word, "eeprom")) {
+      if(numJobLines == MAX_LINES) fail(srcLine, "too many lines");
+      struct jobLine *j = &job[numJobLines++];
+      memset(j, 0, sizeof(*j));
+      j->srcLine = srcLine;
+      j->type    = lineEeprom;
+      parseTime(j, strtok(0, " \t\r\n"));
+      j->motIdx  = motorLetter(strtok(0, " \t\r\n"), srcLine);
+      char *w    = strtok(0, " \t\r\n");
+      char *v    = strtok(0, " \t\r\n");
+      if(w == 0 || v == 0) fail(srcLine, "eeprom needs word and value");
+      j->eeWord  = (!strcmp(w, "last") ? EE_BLOCK_WORDS - 1 : atoi(w));
+      j->eeVal   = strtol(v, 0, 16);
+      if(j->eeWord >= EE_BLOCK_WORDS) fail(srcLine, "eeprom word past block");
+    }
+    else if(!strcmp(word, "cmd") || !strcmp(word, "wait")) {
+      if(numJobLines == MAX_LINES) fail(srcLine, "too many lines");
+      struct jobLine *j = &job[numJobLines++];
+      memset(j, 0, sizeof(*j));
+      j->srcLine = srcLine;
+      j->type    = (word[0] == 'c' ? lineCmd : lineWait);
+      parseTime(j, strtok(0, " \t\r\n"));
+      char *m = strtok(0, " \t\r\n");
+      if(j->type == lineCmd) {
+        j->motIdx = motorLetter(m, srcLine);
+        char *b;
+        while((b = strtok(0, " \t\r\n"))) {
+          if(j->numBytes == MAX_CMD_LEN) fail(srcLine, "cmd too long");
+          j->bytes[j->numBytes++] = strtol(b, 0, 16);
+        }
+        if(j->numBytes == 0) fail(srcLine, "cmd has no bytes");
+      }
+      else {
+        if(m == 0) fail(srcLine, "wait needs motors");
+        for(; *m; m++) {
+          char one[2] = {*m, 0};
+          j->motMask |= (1 << motorLetter(one, srcLine));
+        }
+      }
+    }
+    else fail(srcLine, "unknown item");
+  }
+  fclose(f);
+}
+
+void motorBecameIdle(uint8 motIdx) {
+  int l = pendLine[motIdx];
+  if(l >= 0) {
+    job[l].doneMs = nowMs();
+    pendLine[motIdx] = -1;
+  }
+}
+
+// timed cmd not started yet, motor counts as busy
+bool haveTimedCmd(uint8 motIdx) {
+  int i;
+  for(i = 0; i < HELD_CMDS; i++)
+    if(heldCmds[i].cmd[0] && heldCmds[i].motIdx == motIdx) return true;
+  return false;
+}
+
+void chkMotors() {
+  uint8 motIdx;
+  for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
+    struct motorState *p = &mState[motIdx];
+    bool busy = (p->stateByte & BUSY_BIT) != 0 || haveTimedCmd(motIdx);
+    if(pendLine[motIdx] >= 0) {
+      if(busy) pendSeenBusy[motIdx] = true;
+      else if(pendSeenBusy[motIdx] || !p->haveCommand) motorBecameIdle(motIdx);
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if(argc < 2) {
+    fprintf(stderr, "usage: cycle-sim job.txt [i2c kHz]\n");
+    return 1;
+  }
+  if(argc > 2) i2cKhz = atof(argv[2]);
+  readJob(argv[1]);
+
+  uint8 motIdx;
+  for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) pendLine[motIdx] = -1;
+  simInit();
+
+  clock_t cpuStart  = clock();
+  int     lineIdx   = 0;
+  double  lastDone  = 0;
+  bool    waiting   = false;
+  double  nextPoll  = 0;
+  uint8   waitMask  = 0;
+
+  while(true) {
+    double now = nowMs();
+    if(now > MAX_SIM_SECS * 1000.0) {
+      fprintf(stderr, "sim stopped, job not done after %d secs\n", MAX_SIM_SECS);
+      return 1;
+    }
+    // host, lines are done in order and each i2c packet takes bus time
+    while(lineIdx < numJobLines && !waiting) {
+      struct jobLine *j = &job[lineIdx];
+      double at = (j->relTime ? lastDone + j->timeMs : j->timeMs);
+      if(now < at || now < busFreeMs) break;
+      if(j->type == lineCmd) {
+        int l = pendLine[j->motIdx];
+        if(l >= 0) {
+          job[l].replaced = true;
+          job[l].doneMs   = now;
+        }
+        i2cWrite(j->motIdx, j->bytes, j->numBytes);
+        j->sentMs = lastDone = now;
+        pendLine[j->motIdx]     = lineIdx;
+        pendSeenBusy[j->motIdx] = false;
+        lineIdx++;
+      }
+      else if(j->type == lineReset) {
+        for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) pendLine[motIdx] = -1;
+        simReset();
+        j->sentMs = j->doneMs = lastDone = now;
+        lineIdx++;
+      }
+      else if(j->type == lineEeprom) {
+        eeSettings[j->motIdx][j->eeWord] = j->eeVal;
+        j->sentMs = j->doneMs = lastDone = now;
+        lineIdx++;
+      }
+      else if(j->type == lineGo) {
+        for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
+          if(armedCmd(motIdx)) {
+            pendLine[motIdx]     = lineIdx;
+            pendSeenBusy[motIdx] = false;
+          }
+        }
+        uint8 go = GEN_CALL_GO;
+        i2cGenCall(&go, 1);
+        j->sentMs = lastDone = now;
+        lineIdx++;
+      }
+      else {
+        j->sentMs = now;
+        waiting   = true;
+        waitMask  = j->motMask;
+        nextPoll  = now + pollMs;
+      }
+    }
+    if(waiting && now >= nextPoll && now >= busFreeMs) {
+      for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
+        if((waitMask & (1 << motIdx)) &&
+           (i2cReadStatus(motIdx) & BUSY_BIT) == 0 && !haveTimedCmd(motIdx) &&
+           (eeBusyMask() & (1 << motIdx)) == 0) {
+          waitMask &= ~(1 << motIdx);
+        }
+      }
+      if(waitMask == 0) {
+        job[lineIdx].doneMs = lastDone = now;
+        waiting = false;
+        lineIdx++;
+        continue;
+      }
+      nextPoll = now + pollMs;
+    }
+    if(lineIdx == numJobLines && allMotorsIdle()) break;
+    simTick();
+    chkMotors();
+  }
+  double cpuSecs = (double) (clock() - cpuStart) / CLOCKS_PER_SEC;
+  double cycleMs = nowMs();
+
+  printf("\n line  motor  what       sent ms     done ms    dur ms\n");
+  int l;
+  for(l = 0; l < numJobLines; l++) {
+    struct jobLine *j = &job[l];
+    if(j->type == lineCmd)
+      printf("%5d    %c    cmd 0x%02x %10.3f  %10.3f  %8.3f%s\n",
+             j->srcLine, 'A' + j->motIdx, j->bytes[0], j->sentMs, j->doneMs,
+             j->doneMs - j->sentMs, (j->replaced ? "  (replaced)" : ""));
+    else if(j->type == lineGo)
+      printf("%5d         go       %10.3f  %10.3f  %8.3f\n",
+             j->srcLine, j->sentMs, j->doneMs, j->doneMs - j->sentMs);
+    else if(j->type == lineReset)
+      printf("%5d         reset    %10.3f\n", j->srcLine, j->sentMs);
+    else if(j->type == lineEeprom)
+      printf("%5d    %c    eeprom   %10.3f  word %d = 0x%04x\n", j->srcLine,
+             'A' + j->motIdx, j->sentMs, j->eeWord, j->eeVal);
+    else
+      printf("%5d         wait     %10.3f  %10.3f  %8.3f\n",
+             j->srcLine, j->sentMs, j->doneMs, j->doneMs - j->sentMs);
+  }
+  printf("\ncycle time        %10.3f ms\n", cycleMs);
+  printf("i2c packets       %10u (%u status polls)\n", numPackets, numPolls);
+  printf("i2c bus busy      %10.3f ms, %.2f%% at %g kHz\n", busBusyMs,
+         (cycleMs > 0 ? 100 * busBusyMs / cycleMs : 0), i2cKhz);
+  printMotorStats();
+  printf("sim ran %.0fx real time\n", (cpuSecs > 0 ? cycleMs / 1000 / cpuSecs : 0));
+  return 0;
+}
@@ -0,0 +1,210 @@
+/*
+  trace replay, feeds i2c traffic captured on a production bus through the
+  i2c interrupt of one simulated mcu, with the timer interrupt and event
+  loop running as in cycle-sim
+  build, see sim.c
+  run
+    sim/trace-replay trace.txt [i2c kHz, default 400]
+
+  trace file, one packet per line, # starts a comment
+    config items in sim.c (mcu, start, switch, loop)
+    usecs addr W bytes      host wrote hex bytes
+    usecs addr R count      host read count bytes
+  usecs is when the packet started on the bus, from start of capture
+  addr is the 7-bit i2c addr in hex, 00 is a general call
+  packets to the other mcu only take bus time, as they do on the real bus
+
+  reported
+    cmds that started steps (moves) and moves per second of trace
+    latency from end of cmd packet until event loop took it and until first step
+    errors seen in state bytes by code (OVERFLOW_ERROR, STEP_NOT_DONE_ERROR, ...)
+    steps planned with no lead, output late, and smallest step lead per motor
+    packets that overlap the one before at the given i2c speed
+*/
+
+#include <xc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "types.h"
+#include "motor.h"
+#include "state.h"
+#include "i2c.h"
+#include "sim.h"
+
+#define MAX_PKTS     100000
+#define MAX_PKT_LEN  (SET_BUF_SIZE + 1)
+
+struct tracePkt {
+  int    srcLine;
+  double timeMs;
+  uint8  addr;                    // 7-bit
+  bool   read;
+  uint8  bytes[MAX_PKT_LEN];
+  uint8  numBytes;
+};
+
+struct tracePkt *trace;
+int numPkts;
+
+// latest cmd of each motor, until it is taken and its first step is out
+struct cmdTrack {
+  bool   active;
+  bool   taken;
+  double sentMs;
+  uint32 stepsAtSent;
+} track[NUM_MOTORS];
+
+uint32 numCmds, numTaken, numMoves, numOverlap;
+double takeSumMs, takeMaxMs, stepSumMs, stepMaxMs;
+double capBusFreeMs;  // end of last packet at capture times and sim bus speed
+
+const char *errName[16] = {"", "MOTOR_FAULT_ERROR", "OVERFLOW_ERROR",
+  "CMD_DATA_ERROR", "STEP_NOT_DONE_ERROR", "BOUNDS_ERROR", "NO_SETTINGS",
+  "NOT_HOMED", "", "FOLLOWING_ERROR"};
+
+void readTrace(char *path) {
+  FILE *f = fopen(path, "r");
+  if(f == 0) { perror(path); exit(1); }
+  trace = calloc(MAX_PKTS, sizeof(struct tracePkt));
+  char buf[512];
+  int  srcLine = 0;
+  while(fgets(buf, sizeof(buf), f)) {
+    srcLine++;
+    char *c = strchr(buf, '#');
+    if(c) *c = 0;
+    char *word = strtok(buf, " \t\r\n");
+    if(word == 0 || simConfigItem(word, srcLine)) continue;
+    if(numPkts == MAX_PKTS) fail(srcLine, "too many packets");
+    struct tracePkt *t = &trace[numPkts++];
+    t->srcLine = srcLine;
+    t->timeMs  = atof(word) / 1000;
+    if(numPkts > 1 && t->timeMs < trace[numPkts-2].timeMs)
+      fail(srcLine, "time before previous packet");
+    char *a  = strtok(0, " \t\r\n");
+    char *rw = strtok(0, " \t\r\n");
+    if(a == 0 || rw == 0 || (strcmp(rw, "W") && strcmp(rw, "R")))
+      fail(srcLine, "packet must be: usecs addr W|R ...");
+    t->addr = strtol(a, 0, 16);
+    if(t->addr > 0x7f) fail(srcLine, "addr is 7 bits");
+    t->read = (rw[0] == 'R');
+    if(t->read) {
+      int n = atoi(strtok(0, " \t\r\n") ?: "0");
+      if(n < 1 || n > MAX_PKT_LEN) fail(srcLine, "bad read count");
+      t->numBytes = n;
+    }
+    else {
+      char *b;
+      while((b = strtok(0, " \t\r\n"))) {
+        if(t->numBytes == MAX_PKT_LEN) fail(srcLine, "packet too long");
+        t->bytes[t->numBytes++] = strtol(b, 0, 16);
+      }
+      if(t->numBytes == 0) fail(srcLine, "write has no bytes");
+    }
+  }
+  fclose(f);
+}
+
+void chkTrack() {
+  double now = nowMs();
+  uint8 motIdx;
+  for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
+    struct cmdTrack *k = &track[motIdx];
+    if(!k->active) continue;
+    if(!k->taken && !mState[motIdx].haveCommand) {
+      double ms = now - k->sentMs;
+      k->taken   = true;
+      numTaken++;
+      takeSumMs += ms;
+      if(ms > takeMaxMs) takeMaxMs = ms;
+    }
+    if(k->taken && stepsOut[motIdx] != k->stepsAtSent) {
+      double ms = now - k->sentMs;
+      k->active  = false;
+      stepSumMs += ms;
+      if(ms > stepMaxMs) stepMaxMs = ms;
+      numMoves++;
+    }
+  }
+}
+
+void sendPkt(struct tracePkt *t) {
+  // capture had a packet on the bus sooner than the sim bus speed allows
+  if(t->timeMs < capBusFreeMs) numOverlap++;
+  capBusFreeMs = (t->timeMs > capBusFreeMs ? t->timeMs : capBusFreeMs) +
+                 ((t->numBytes + 1) * 9 + 2) / i2cKhz;
+  if(t->read) {
+    uint8 bytes[MAX_PKT_LEN];
+    i2cReadAddr(t->addr, bytes, t->numBytes);
+    return;
+  }
+  // mcu drops packets to addrs in its block past its last motor
+  uint8  motIdx   = t->addr & ((1 << I2C_MOTOR_BITS) - 1);
+  bool   forMotor = (t->addr != 0 && addrForUs(t->addr) && motIdx < NUM_MOTORS);
+  if(!forMotor) motIdx = 0;
+  uint32 steps    = stepsOut[motIdx];
+  i2cWriteAddr(t->addr, t->bytes, t->numBytes);
+  if(forMotor) {
+    struct cmdTrack *k = &track[motIdx];
+    // a cmd that replaced an unfinished one has no first step of its own
+    k->active      = true;
+    k->taken       = false;
+    k->sentMs      = nowMs();
+    k->stepsAtSent = steps;
+    numCmds++;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if(argc < 2) {
+    fprintf(stderr, "usage: trace-replay trace.txt [i2c kHz]\n");
+    return 1;
+  }
+  if(argc > 2) i2cKhz = atof(argv[2]);
+  readTrace(argv[1]);
+  printErrors = false;
+  simInit();
+
+  clock_t cpuStart = clock();
+  int     pktIdx   = 0;
+  while(true) {
+    double now = nowMs();
+    if(now > MAX_SIM_SECS * 1000.0) {
+      fprintf(stderr, "sim stopped, motors busy %d secs\n", MAX_SIM_SECS);
+      return 1;
+    }
+    // packets go in at the timer int after their capture time
+    while(pktIdx < numPkts && now >= trace[pktIdx].timeMs) {
+      sendPkt(&trace[pktIdx++]);
+      chkTrack();
+    }
+    if(pktIdx == numPkts && allMotorsIdle()) break;
+    simTick();
+    chkTrack();
+  }
+  double cpuSecs = (double) (clock() - cpuStart) / CLOCKS_PER_SEC;
+  double traceMs = nowMs();
+
+  printf("\ntrace time        %10.3f ms, %d packets\n", traceMs, numPkts);
+  printf("i2c bus busy      %10.3f ms, %.2f%% at %g kHz\n", busBusyMs,
+         (traceMs > 0 ? 100 * busBusyMs / traceMs : 0), i2cKhz);
+  if(numOverlap)
+    printf("packets overlapped%10u (capture too fast for %g kHz)\n", numOverlap, i2cKhz);
+  printf("cmds to this mcu  %10u\n", numCmds);
+  printf("moves             %10u, %.1f per sec\n", numMoves,
+         (traceMs > 0 ? numMoves * 1000 / traceMs : 0));
+  if(numTaken)
+    printf("cmd taken after   %10.3f ms avg, %.3f ms max\n",
+           takeSumMs / numTaken, takeMaxMs);
+  if(numMoves)
+    printf("first step after  %10.3f ms avg, %.3f ms max\n",
+           stepSumMs / numMoves, stepMaxMs);
+  int e;
+  for(e = 1; e < 16; e++)
+    if(errCount[e] || e == (OVERFLOW_ERROR >> 4) || e == (STEP_NOT_DONE_ERROR >> 4))
+      printf("%-18s%10u\n", errName[e], errCount[e]);
+  printMotorStats();
+  printf("sim ran %.0fx real time\n", (cpuSecs > 0 ? traceMs / 1000 / cpuSecs : 0));
+  return 0;
+}
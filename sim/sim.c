@@ -0,0 +1,392 @@
+/*
+  host sim of one mcu running the real motor code against virtual time
+  used by cycle-sim (job.c) and trace-replay (replay.c)
+
+  build on host from repo root (sim/xc.h stands in for xc16 <xc.h>)
+    MCU="clock.c dist-table.c encoder.c eeprom.c home.c i2c.c main.c motor.c \
+         move.c state.c stop.c sync.c"
+    gcc -O2 -I sim -I . -Dmain=mcuMain -o sim/cycle-sim    sim/sim.c sim/job.c    $MCU
+    gcc -O2 -I sim -I . -Dmain=mcuMain -o sim/trace-replay sim/sim.c sim/replay.c $MCU
+
+  the timer, limit sw, and i2c interrupt routines and the event loop pass are
+  the mcu code, only the pins and the host are simulated
+  each i2c packet is fed byte by byte through _MSSP1Interrupt
+  motor position is tracked from the steps the timer interrupt outputs,
+  so limit switches close where the real motor would be
+  a motor with encoder pins (board file) and encRatio setting has its
+  encoder pins driven from that position, one count per pin change
+
+  config items allowed in both job and trace files, motors are A-D
+    mcu    A|B              which mcu is simulated, sets i2c addr (default A)
+    start  m pos            motor pos before job in 1/8 steps (default 0)
+    switch m pos [hi]       limit sw closed at or below pos (at or above if hi)
+    loop   n                event loop pass once per n timer ints (default 1)
+    stall  m pos            motor jams at pos, steps past it are lost
+*/
+
+#define SIM_DEFINE_SFRS
+#include <xc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "pins.h"
+#include "motor.h"
+#include "state.h"
+#include "clock.h"
+#include "i2c.h"
+#include "move.h"
+#include "sync.h"
+#include "sim.h"
+
+// input pins the sim drives, tables generated in pins.h
+volatile uint16 *limPort[NUM_MOTORS]   = LIM_PORTS;
+const    uint16  limMask[NUM_MOTORS]   = LIM_MASKS;
+volatile uint16 *faultPort[NUM_MOTORS] = FAULT_PORTS;
+const    uint16  faultMask[NUM_MOTORS] = FAULT_MASKS;
+volatile uint16 *encAPort[NUM_MOTORS]  = ENC_A_PORTS;
+const    uint16  encAMask[NUM_MOTORS]  = ENC_A_MASKS;
+volatile uint16 *encBPort[NUM_MOTORS]  = ENC_B_PORTS;
+const    uint16  encBMask[NUM_MOTORS]  = ENC_B_MASKS;
+
+void _T1Interrupt(void);
+void _CNInterrupt(void);
+void _MSSP1Interrupt(void);
+void eventLoopPass(void);
+
+int32  physPos[NUM_MOTORS];
+uint32 stepsOut[NUM_MOTORS];
+int16  minLead[NUM_MOTORS];
+uint32 lateSteps[NUM_MOTORS];
+uint32 errCount[16];
+bool   printErrors = true;
+
+bool   haveSw[NUM_MOTORS];
+bool   swHi[NUM_MOTORS];
+int32  swPos[NUM_MOTORS];
+uint8  lastErr[NUM_MOTORS];
+bool   haveStall[NUM_MOTORS];
+int32  stallPos[NUM_MOTORS];
+bool   stallAbove[NUM_MOTORS];    // motor starts above stall pos
+int32  encSimCount[NUM_MOTORS];
+bool   encSimOn[NUM_MOTORS];      // encoder counts started from motor pos
+bool   mcuB;
+
+int    loopInts  = 1;
+double i2cKhz    = 400;
+
+uint64_t nowCounts;
+uint32   intCount;
+
+double   busBusyMs;
+double   busFreeMs;
+uint32   numPackets;
+uint32   numPolls;
+
+void fail(int srcLine, char *msg) {
+  fprintf(stderr, "line %d: %s\n", srcLine, msg);
+  exit(1);
+}
+
+int motorLetter(char *s, int srcLine) {
+  if(s == 0 || s[0] < 'A' || s[0] > 'A' + NUM_MOTORS - 1 || s[1])
+    fail(srcLine, "motor must be A-D");
+  return s[0] - 'A';
+}
+
+// config item shared by job and trace files, strtok is at its first arg
+bool simConfigItem(char *word, int srcLine) {
+  if(!strcmp(word, "start")) {
+    int m = motorLetter(strtok(0, " \t\r\n"), srcLine);
+    physPos[m] = atol(strtok(0, " \t\r\n") ?: "0");
+  }
+  else if(!strcmp(word, "switch")) {
+    int m = motorLetter(strtok(0, " \t\r\n"), srcLine);
+    swPos[m]  = atol(strtok(0, " \t\r\n") ?: "0");
+    char *hi  = strtok(0, " \t\r\n");
+    swHi[m]   = (hi && !strcmp(hi, "hi"));
+    haveSw[m] = true;
+  }
+  else if(!strcmp(word, "mcu")) {
+    char *s = strtok(0, " \t\r\n");
+    if(s == 0 || (strcmp(s, "A") && strcmp(s, "B"))) fail(srcLine, "mcu must be A or B");
+    mcuB = (s[0] == 'B');
+  }
+  else if(!strcmp(word, "stall")) {
+    int m = motorLetter(strtok(0, " \t\r\n"), srcLine);
+    stallPos[m]  = atol(strtok(0, " \t\r\n") ?: "0");
+    haveStall[m] = true;
+  }
+  else if(!strcmp(word, "loop")) {
+    loopInts = atoi(strtok(0, " \t\r\n") ?: "1");
+    if(loopInts < 1) loopInts = 1;
+  }
+  else return false;
+  return true;
+}
+
+// ---------- i2c host, packets go through the mcu i2c interrupt ----------
+
+void busTime(uint8 numBytes) {
+  // addr byte + data bytes, 9 bits each, plus start and stop
+  double ms = ((numBytes + 1) * 9 + 2) / i2cKhz;
+  busBusyMs += ms;
+  busFreeMs  = (busFreeMs > nowMs() ? busFreeMs : nowMs()) + ms;
+  numPackets++;
+}
+
+// same match the mssp hardware does with SSP1ADD and SSP1MSK
+bool addrForUs(uint8 addr7) {
+  return (addr7 == 0 || ((addr7 << 1) & I2C_ADDR_MASK) == i2cAddrBase);
+}
+
+void i2cStart(uint8 addr7, bool read) {
+  SSP1STATbits.S = 1;
+  SSP1STATbits.P = 0;
+  _MSSP1Interrupt();
+  SSP1STATbits.NOT_ADDRESS = 0;
+  SSP1STATbits.I2C_READ    = read;
+  SSP1BUF = (addr7 << 1) | read;
+  _MSSP1Interrupt();
+  SSP1STATbits.NOT_ADDRESS = 1;
+}
+
+void i2cStop() {
+  SSP1STATbits.S = 0;
+  SSP1STATbits.P = 1;
+  _MSSP1Interrupt();
+  SSP1STATbits.P = 0;
+}
+
+// i2c interrupt wakes mcu from Idle() for an event loop pass
+void i2cWake() {
+  if(clkLowPowerOn) loopPass();
+}
+
+// packets for another mcu on the bus only take bus time
+void i2cWriteAddr(uint8 addr7, uint8 *bytes, uint8 numBytes) {
+  busTime(numBytes);
+  if(!addrForUs(addr7)) return;
+  i2cStart(addr7, false);
+  uint8 i;
+  for(i = 0; i < numBytes; i++) {
+    SSP1BUF = bytes[i];
+    _MSSP1Interrupt();
+  }
+  i2cStop();
+  i2cWake();
+}
+
+// general call, every mcu on the bus gets it
+void i2cGenCall(uint8 *bytes, uint8 numBytes) {
+  i2cWriteAddr(0, bytes, numBytes);
+}
+
+void i2cReadAddr(uint8 addr7, uint8 *bytes, uint8 numBytes) {
+  busTime(numBytes);
+  numPolls++;
+  if(!addrForUs(addr7)) {
+    memset(bytes, 0, numBytes);
+    return;
+  }
+  i2cStart(addr7, true);
+  uint8 i;
+  for(i = 0; i < numBytes; i++) {
+    if(i) _MSSP1Interrupt();
+    bytes[i] = SSP1BUF;
+  }
+  i2cStop();
+  i2cWake();
+}
+
+// status read, returns state byte
+uint8 i2cReadStatus(uint8 motIdx) {
+  uint8 bytes[3];
+  i2cReadAddr(motorAddr(motIdx), bytes, 3);
+  return bytes[0];
+}
+
+// ---------- pins ----------
+
+void setLimitPins() {
+  bool changed = false;
+  uint8 motIdx;
+  for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
+    bool closed = haveSw[motIdx] && (swHi[motIdx] ? physPos[motIdx] >= swPos[motIdx]
+                                                  : physPos[motIdx] <= swPos[motIdx]);
+    bool pol    = (mSet[motIdx].val.limitSwCtl & LIM_POL_MASK) != 0;
+    bool level  = (closed ? pol : !pol);
+    volatile uint16 *p = limPort[motIdx];
+    if(((*p & limMask[motIdx]) != 0) != level) {
+      if(level) *p |=  limMask[motIdx];
+      else      *p &= ~limMask[motIdx];
+      changed = true;
+    }
+  }
+  if(changed && _CNIE) _CNInterrupt();
+}
+
+// encoder counts follow motor pos, each count is one pin change
+void setEncPins() {
+  uint8 motIdx;
+  for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
+    uint16 ratio = mSet[motIdx].val.encRatio;
+    if(encAPort[motIdx] == 0 || ratio == 0) continue;
+    int64_t num  = (int64_t) physPos[motIdx] * 256;
+    int32 target = (int32) ((num >= 0 ? num : num - (ratio - 1)) / ratio);
+    if(!encSimOn[motIdx]) {
+      // pins are low (count & 3 == 0) when the setting turns the encoder on
+      encSimCount[motIdx] = target & ~3;
+      encSimOn[motIdx]    = true;
+    }
+    while(encSimCount[motIdx] != target) {
+      encSimCount[motIdx] += (target > encSimCount[motIdx] ? 1 : -1);
+      // gray code 00 01 11 10
+      uint8 q = encSimCount[motIdx] & 3;
+      if(q == 2 || q == 3) *encAPort[motIdx] |=  encAMask[motIdx];
+      else                 *encAPort[motIdx] &= ~encAMask[motIdx];
+      if(q == 1 || q == 2) *encBPort[motIdx] |=  encBMask[motIdx];
+      else                 *encBPort[motIdx] &= ~encBMask[motIdx];
+      if(_CNIE) _CNInterrupt();
+    }
+  }
+}
+
+// step output moves motor unless it is jammed at its stall pos
+void movePhys(uint8 motIdx, int16 dist) {
+  int32 pos = physPos[motIdx] + dist;
+  if(haveStall[motIdx]) {
+    if( stallAbove[motIdx] && pos < stallPos[motIdx]) pos = stallPos[motIdx];
+    if(!stallAbove[motIdx] && pos > stallPos[motIdx]) pos = stallPos[motIdx];
+  }
+  physPos[motIdx] = pos;
+}
+
+// one timer interrupt, motor pos follows the steps it outputs
+void timerInt() {
+  uint8  fireBefore[NUM_MOTORS];
+  int16  posBefore[NUM_MOTORS];
+  uint8  motIdx;
+  for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
+    fireBefore[motIdx] = sState[motIdx].stepQFire;
+    posBefore[motIdx]  = mState[motIdx].curPos;
+  }
+  _T1Interrupt();
+  for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
+    struct motorState *p = &mState[motIdx];
+    struct stepState  *s = &sState[motIdx];
+    uint8 i;
+    for(i = fireBefore[motIdx]; i != s->stepQFire; i++) {
+      uint8 ctl = s->stepQCtl[i & (STEP_Q_LEN - 1)];
+      movePhys(motIdx, ((ctl & STEP_DIR_BIT) ? 1 : -1) * uStepDist[ctl & 0x03]);
+      stepsOut[motIdx]++;
+    }
+    if(s->segMode && p->curPos != posBefore[motIdx]) {
+      // interrupt stepped a host segment, no backlash so curPos is motor pos
+      movePhys(motIdx, (int16) (p->curPos - posBefore[motIdx]));
+      stepsOut[motIdx]++;
+    }
+  }
+  nowCounts += (uint32) PR1 + 1;
+}
+
+// event loop pass, lead of each step planned in it
+void loopPass() {
+  uint8 planBefore[NUM_MOTORS];
+  uint8 motIdx;
+  for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++)
+    planBefore[motIdx] = sState[motIdx].stepQPlan;
+  eventLoopPass();
+  for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
+    struct stepState *s = &sState[motIdx];
+    uint8 i;
+    if((uint8) (s->stepQPlan - planBefore[motIdx]) > STEP_Q_LEN)
+      continue;  // planned steps were cancelled
+    for(i = planBefore[motIdx]; i != s->stepQPlan; i++) {
+      int16 lead = (int16) (s->stepQTicks[i & (STEP_Q_LEN - 1)] - timeTicks);
+      if(lead < minLead[motIdx]) minLead[motIdx] = lead;
+      if(lead < 1) lateSteps[motIdx]++;
+    }
+  }
+}
+
+// count each error when it shows up in the state byte
+void chkErrors() {
+  uint8 motIdx;
+  for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
+    struct motorState *p = &mState[motIdx];
+    uint8 err = stateErrCode(p->stateByte);
+    if(err && err != lastErr[motIdx]) {
+      errCount[err >> 4]++;
+      if(printErrors)
+        printf("%10.3f ms  motor %c error 0x%02x at pos %d\n",
+               nowMs(), 'A' + motIdx, err, p->curPos);
+    }
+    lastErr[motIdx] = err;
+  }
+}
+
+bool allMotorsIdle() {
+  uint8 motIdx;
+  for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
+    if((mState[motIdx].stateByte & BUSY_BIT) || mState[motIdx].haveCommand)
+      return false;
+  }
+  return (timedCount == 0);
+}
+
+// call after config items are read
+void simInit() {
+  uint8 motIdx;
+  for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
+    minLead[motIdx] = 0x7fff;
+    stallAbove[motIdx] = (physPos[motIdx] > stallPos[motIdx]);
+    // no motor faults
+    *faultPort[motIdx] |= faultMask[motIdx];
+  }
+  // same startup as mcu main()
+  IDPORT = mcuB;
+  setI2cId();
+  i2cInit();
+  clkInit();
+  motorInit();
+  setLimitPins();
+}
+
+// mcu reset, motor ram is lost and settings come from eeprom again
+// sim time and motor positions go on
+void simReset() {
+  uint8 motIdx;
+  memset(mSet,   0, sizeof(mSet));
+  memset(mState, 0, sizeof(mState));
+  memset(sState, 0, sizeof(sState));
+  for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
+    haveSettings[motIdx] = false;
+    encSimOn[motIdx]     = false;
+  }
+  motorInit();
+  setLimitPins();
+}
+
+// one timer interrupt and the event loop passes it allows
+void simTick() {
+  timerInt();
+  setLimitPins();
+  setEncPins();
+  if(++intCount % loopInts == 0) loopPass();
+  chkErrors();
+}
+
+void printMotorStats() {
+  uint8 motIdx;
+  for(motIdx = 0; motIdx < NUM_MOTORS; motIdx++) {
+    if(stepsOut[motIdx] == 0) continue;
+    printf("motor %c           %10u steps, pos %d, ", 'A' + motIdx,
+           stepsOut[motIdx], physPos[motIdx]);
+    if(minLead[motIdx] == 0x7fff) printf("no planned steps\n");
+    else printf("min step lead %d ticks%s\n", minLead[motIdx],
+                (minLead[motIdx] < 2 ? "  (STEP_NOT_DONE risk)" : ""));
+    if(lateSteps[motIdx])
+      printf("                  %10u steps planned late\n", lateSteps[motIdx]);
+  }
+}
@@ -0,0 +1,58 @@
+// host sim of one mcu, shared by cycle-sim (job.c) and trace-replay (replay.c)
+// see sim.c for how the mcu code is driven
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include "types.h"
+#include "motor.h"
+#include "clock.h"
+
+// mcu main() is built as mcuMain, the sim tools have their own main()
+#undef main
+
+#define MAX_SIM_SECS 3600
+
+// sim state of each motor
+extern int32  physPos[NUM_MOTORS];  // from steps output, 1/8 steps
+extern uint32 stepsOut[NUM_MOTORS];
+extern int16  minLead[NUM_MOTORS];  // ticks from when step planned to when due
+extern uint32 lateSteps[NUM_MOTORS];// planned with no lead, output late
+extern uint32 errCount[16];         // errors seen in state bytes, by code >> 4
+extern bool   printErrors;
+
+extern int    loopInts;
+extern double i2cKhz;
+
+// virtual time in timer counts (16 per usec)
+extern uint64_t nowCounts;
+#define nowMs() ((double) nowCounts / (TMR_COUNTS_PER_USEC * 1000.0))
+
+extern double busBusyMs;
+extern double busFreeMs;  // host waits for last packet to finish
+extern uint32 numPackets;
+extern uint32 numPolls;
+
+void  fail(int srcLine, char *msg);
+int   motorLetter(char *s, int srcLine);
+bool  simConfigItem(char *word, int srcLine);
+
+void  simInit(void);
+void  simReset(void);
+void  simTick(void);
+void  loopPass(void);
+bool  allMotorsIdle(void);
+void  printMotorStats(void);
+
+// 7-bit bus addr of a motor on the simulated mcu
+#define motorAddr(_motIdx) ((i2cAddrBase >> 1) + (_motIdx))
+bool  addrForUs(uint8 addr7);
+
+void  i2cWriteAddr(uint8 addr7, uint8 *bytes, uint8 numBytes);
+void  i2cReadAddr(uint8 addr7, uint8 *bytes, uint8 numBytes);
+void  i2cGenCall(uint8 *bytes, uint8 numBytes);
+#define i2cWrite(_motIdx, _b, _n) i2cWriteAddr(motorAddr(_motIdx), _b, _n)
+uint8 i2cReadStatus(uint8 motIdx);
+
+#endif /* SIM_H */
@@ -0,0 +1,132 @@
+// stand-in for the xc16 <xc.h> when the mcu code is built on a host by sim.c
+// every SFR is a plain variable, see sim.c for how they are driven
+
+#ifndef SIM_XC_H
+#define SIM_XC_H
+
+#include <stdint.h>
+
+// sim.c defines the SFRs, all other files only declare them
+#ifdef SIM_DEFINE_SFRS
+#define SFR(_t, _n) volatile _t _n
+#else
+#define SFR(_t, _n) extern volatile _t _n
+#endif
+
+// xc16 attributes that mean nothing on a host
+#define interrupt   unused
+#define shadow      unused
+#define auto_psv    unused
+#define space(_s)   unused
+#define address(_a) unused
+
+// no nested interrupts in the sim, interrupts run between event loop passes
+#define __builtin_disi(_n) ((void) 0)
+#define Idle()             ((void) 0)
+#define Nop()              ((void) 0)
+#define ClrWdt()           ((void) 0)
+
+// data eeprom is plain memory, writes are done by the sim immediately
+#define __builtin_tblpage(_p)    0
+#define __builtin_tbloffset(_p)  ((uintptr_t) (_p))
+#define __builtin_tblrdl(_o)     (*(volatile uint16_t *) (uintptr_t) (_o))
+#define __builtin_tblwtl(_o, _v) (*(volatile uint16_t *) (uintptr_t) (_o) = (_v))
+#define __builtin_write_NVM()    ((void) 0)
+
+struct sspStatBits { unsigned BF:1, UA:1, I2C_READ:1, S:1, P:1, NOT_ADDRESS:1, CKE:1, SMP:1; };
+struct sspCon1Bits { unsigned SSPM:4, CKP:1, SSPEN:1, SSPOV:1, WCOL:1; };
+struct sspCon2Bits { unsigned SEN:1, RSEN:1, PEN:1, RCEN:1, ACKEN:1, ACKDT:1, ACKSTAT:1, GCEN:1; };
+struct sspCon3Bits { unsigned DHEN:1, AHEN:1, SBCDE:1, SDAHT:1, BOEN:1, SCIE:1, PCIE:1, ACKTIM:1; };
+struct nvmConBits  { unsigned NVMOP:6, ERASE:1, PGMONLY:1, unused1:4, WRERR:1, WREN:1, unused2:1, WR:1; };
+
+SFR(struct sspStatBits, SSP1STATbits);
+SFR(struct sspCon1Bits, SSP1CON1bits);
+SFR(struct sspCon2Bits, SSP1CON2bits);
+SFR(struct sspCon3Bits, SSP1CON3bits);
+SFR(struct nvmConBits,  NVMCONbits);
+
+SFR(uint16_t, SSP1BUF); SFR(uint16_t, SSP1MSK); SFR(uint16_t, SSP1ADD);
+SFR(uint16_t, PR1);     SFR(uint16_t, TMR1);
+SFR(uint16_t, ANSA);    SFR(uint16_t, ANSB);
+SFR(uint16_t, PORTA);   SFR(uint16_t, PORTB);
+SFR(uint16_t, LATA);    SFR(uint16_t, LATB);
+SFR(uint16_t, TRISA);   SFR(uint16_t, TRISB);
+SFR(uint16_t, NVMCON);  SFR(uint16_t, NVMADR);  SFR(uint16_t, NVMADRU);
+SFR(uint16_t, TBLPAG);
+
+SFR(uint16_t, _SSP1IF); SFR(uint16_t, _SSP1IE); SFR(uint16_t, _SSP1IP);
+SFR(uint16_t, _T1IF);   SFR(uint16_t, _T1IE);   SFR(uint16_t, _T1IP);
+SFR(uint16_t, _TSYNC);  SFR(uint16_t, _TCS);    SFR(uint16_t, _TCKPS);
+SFR(uint16_t, _TON);    SFR(uint16_t, _RCDIV);  SFR(uint16_t, _NSTDIS);
+SFR(uint16_t, _CNIF);   SFR(uint16_t, _CNIE);   SFR(uint16_t, _CNIP);
+SFR(uint16_t, _NVMIF);  SFR(uint16_t, _WR);     SFR(uint16_t, _WREN);
+SFR(uint16_t, _DOZE);   SFR(uint16_t, _DOZEN);
+
+// port bits are separate from the port words, sim.c only uses the words
+SFR(uint16_t, _TRISA0); SFR(uint16_t, _LATA0); SFR(uint16_t, _RA0);
+SFR(uint16_t, _TRISA1); SFR(uint16_t, _LATA1); SFR(uint16_t, _RA1);
+SFR(uint16_t, _TRISA2); SFR(uint16_t, _LATA2); SFR(uint16_t, _RA2);
+SFR(uint16_t, _TRISA3); SFR(uint16_t, _LATA3); SFR(uint16_t, _RA3);
+SFR(uint16_t, _TRISA4); SFR(uint16_t, _LATA4); SFR(uint16_t, _RA4);
+SFR(uint16_t, _TRISA5); SFR(uint16_t, _LATA5); SFR(uint16_t, _RA5);
+SFR(uint16_t, _TRISA6); SFR(uint16_t, _LATA6); SFR(uint16_t, _RA6);
+SFR(uint16_t, _TRISA7); SFR(uint16_t, _LATA7); SFR(uint16_t, _RA7);
+SFR(uint16_t, _TRISA8); SFR(uint16_t, _LATA8); SFR(uint16_t, _RA8);
+SFR(uint16_t, _TRISA9); SFR(uint16_t, _LATA9); SFR(uint16_t, _RA9);
+SFR(uint16_t, _TRISA10); SFR(uint16_t, _LATA10); SFR(uint16_t, _RA10);
+SFR(uint16_t, _TRISA11); SFR(uint16_t, _LATA11); SFR(uint16_t, _RA11);
+SFR(uint16_t, _TRISA12); SFR(uint16_t, _LATA12); SFR(uint16_t, _RA12);
+SFR(uint16_t, _TRISA13); SFR(uint16_t, _LATA13); SFR(uint16_t, _RA13);
+SFR(uint16_t, _TRISA14); SFR(uint16_t, _LATA14); SFR(uint16_t, _RA14);
+SFR(uint16_t, _TRISA15); SFR(uint16_t, _LATA15); SFR(uint16_t, _RA15);
+SFR(uint16_t, _TRISB0); SFR(uint16_t, _LATB0); SFR(uint16_t, _RB0);
+SFR(uint16_t, _TRISB1); SFR(uint16_t, _LATB1); SFR(uint16_t, _RB1);
+SFR(uint16_t, _TRISB2); SFR(uint16_t, _LATB2); SFR(uint16_t, _RB2);
+SFR(uint16_t, _TRISB3); SFR(uint16_t, _LATB3); SFR(uint16_t, _RB3);
+SFR(uint16_t, _TRISB4); SFR(uint16_t, _LATB4); SFR(uint16_t, _RB4);
+SFR(uint16_t, _TRISB5); SFR(uint16_t, _LATB5); SFR(uint16_t, _RB5);
+SFR(uint16_t, _TRISB6); SFR(uint16_t, _LATB6); SFR(uint16_t, _RB6);
+SFR(uint16_t, _TRISB7); SFR(uint16_t, _LATB7); SFR(uint16_t, _RB7);
+SFR(uint16_t, _TRISB8); SFR(uint16_t, _LATB8); SFR(uint16_t, _RB8);
+SFR(uint16_t, _TRISB9); SFR(uint16_t, _LATB9); SFR(uint16_t, _RB9);
+SFR(uint16_t, _TRISB10); SFR(uint16_t, _LATB10); SFR(uint16_t, _RB10);
+SFR(uint16_t, _TRISB11); SFR(uint16_t, _LATB11); SFR(uint16_t, _RB11);
+SFR(uint16_t, _TRISB12); SFR(uint16_t, _LATB12); SFR(uint16_t, _RB12);
+SFR(uint16_t, _TRISB13); SFR(uint16_t, _LATB13); SFR(uint16_t, _RB13);
+SFR(uint16_t, _TRISB14); SFR(uint16_t, _LATB14); SFR(uint16_t, _RB14);
+SFR(uint16_t, _TRISB15); SFR(uint16_t, _LATB15); SFR(uint16_t, _RB15);
+
+SFR(uint16_t, _CN0IE); SFR(uint16_t, _CN0PUE);
+SFR(uint16_t, _CN1IE); SFR(uint16_t, _CN1PUE);
+SFR(uint16_t, _CN2IE); SFR(uint16_t, _CN2PUE);
+SFR(uint16_t, _CN3IE); SFR(uint16_t, _CN3PUE);
+SFR(uint16_t, _CN4IE); SFR(uint16_t, _CN4PUE);
+SFR(uint16_t, _CN5IE); SFR(uint16_t, _CN5PUE);
+SFR(uint16_t, _CN6IE); SFR(uint16_t, _CN6PUE);
+SFR(uint16_t, _CN7IE); SFR(uint16_t, _CN7PUE);
+SFR(uint16_t, _CN8IE); SFR(uint16_t, _CN8PUE);
+SFR(uint16_t, _CN9IE); SFR(uint16_t, _CN9PUE);
+SFR(uint16_t, _CN10IE); SFR(uint16_t, _CN10PUE);
+SFR(uint16_t, _CN11IE); SFR(uint16_t, _CN11PUE);
+SFR(uint16_t, _CN12IE); SFR(uint16_t, _CN12PUE);
+SFR(uint16_t, _CN13IE); SFR(uint16_t, _CN13PUE);
+SFR(uint16_t, _CN14IE); SFR(uint16_t, _CN14PUE);
+SFR(uint16_t, _CN15IE); SFR(uint16_t, _CN15PUE);
+SFR(uint16_t, _CN16IE); SFR(uint16_t, _CN16PUE);
+SFR(uint16_t, _CN17IE); SFR(uint16_t, _CN17PUE);
+SFR(uint16_t, _CN18IE); SFR(uint16_t, _CN18PUE);
+SFR(uint16_t, _CN19IE); SFR(uint16_t, _CN19PUE);
+SFR(uint16_t, _CN20IE); SFR(uint16_t, _CN20PUE);
+SFR(uint16_t, _CN21IE); SFR(uint16_t, _CN21PUE);
+SFR(uint16_t, _CN22IE); SFR(uint16_t, _CN22PUE);
+SFR(uint16_t, _CN23IE); SFR(uint16_t, _CN23PUE);
+SFR(uint16_t, _CN24IE); SFR(uint16_t, _CN24PUE);
+SFR(uint16_t, _CN25IE); SFR(uint16_t, _CN25PUE);
+SFR(uint16_t, _CN26IE); SFR(uint16_t, _CN26PUE);
+SFR(uint16_t, _CN27IE); SFR(uint16_t, _CN27PUE);
+SFR(uint16_t, _CN28IE); SFR(uint16_t, _CN28PUE);
+SFR(uint16_t, _CN29IE); SFR(uint16_t, _CN29PUE);
+SFR(uint16_t, _CN30IE); SFR(uint16_t, _CN30PUE);
+SFR(uint16_t, _CN31IE); SFR(uint16_t, _CN31PUE);
+
+#endif /* SIM_XC_H */
@@ -5,10 +5,12 @@
 #include "i2c.h"
 #include "motor.h"
 #include "stop.h"
+#include "clock.h"
 
 volatile int dummy = 0; // used for reading register and ignoring value
 
 struct motorState mState[NUM_MOTORS];
+struct stepState  sState[NUM_MOTORS];
 
 void setStateBit(uint8 mask, uint8 set){
   disableAllInts;
@@ -16,24 +18,65 @@ void setStateBit(uint8 mask, uint8 set){
   enableAllInts;
 }
 
+// adds to history, from interrupt or with interrupts disabled
+void logError(uint8 motIdx, uint8 err) {
+  if(errHistCount == ERR_HIST_LEN) {
+    // keep first errors, they usually explain the rest
+    return;
+  }
+  struct errHistEntry *e = 
+              &errHist[(errHistHead + errHistCount) & (ERR_HIST_LEN - 1)];
+  e->ticks  = timeTicks;
+  e->motIdx = motIdx;
+  e->code   = err;
+  e->pos    = mState[motIdx].curPos;
+  e->speed  = mState[motIdx].curSpeed;
+  errHistCount++;
+}
+
+// error found in event loop
 void setError(uint8 err) {
+  if(err != CLEAR_ERROR) {
+    disableAllInts;
+    logError(motorIdx, err);
+    enableAllInts;
+  }
+  errorState(err);
+}
+
+// apply error to motor state, already in history
+void errorState(uint8 err) {
   if(err == CLEAR_ERROR) {
     disableAllInts;
-    ms->stateByte = ms->stateByte & ~ERR_CODE;
+    ms->stateByte = ms->stateByte & ~(ERR_CODE | ERR_EXT_BIT);
     enableAllInts;
     dummy = I2C_BUF_BYTE;   // clear SSPOV
   }
+  else if(errReportOnly(err)) {
+    // an error already waiting to be read is kept, it may have stopped motor
+    disableAllInts;
+    if((ms->stateByte & ERR_CODE) == 0) ms->stateByte |= err;
+    enableAllInts;
+  }
   else {
-    ms->stateByte = err;
+    ms->stateByte = (err & ERR_CODE) | ((err & 0x80) ? ERR_EXT_BIT : 0);
     resetMotor();
   }
 }
 
-volatile uint8 errorIntMot;
-volatile uint8 errorIntCode;
+volatile uint8 errorIntCode[NUM_MOTORS];
+
+struct errHistEntry errHist[ERR_HIST_LEN];
+volatile uint8 errHistHead;
+volatile uint8 errHistCount;
 
 // used in interrupt
+// first error waiting in mailbox is kept, but a real error replaces a clear
 void setErrorInt(uint8 motIdx, uint8 err) {
-  errorIntMot  = motIdx;
-  errorIntCode = err;
+  if(err != CLEAR_ERROR) {
+    logError(motIdx, err);
+  }
+  if(errorIntCode[motIdx] == 0 || errorIntCode[motIdx] == CLEAR_ERROR) {
+    errorIntCode[motIdx] = err;
+  }
 }
@@ -20,58 +20,144 @@ extern volatile int dummy;
 #define BOUNDS_ERROR        0x50
 #define NO_SETTINGS         0x60
 #define NOT_HOMED           0x70
+// codes from 0x90 are shown in the state byte as code & ERR_CODE with
+// ERR_EXT_BIT set, a normal status never has that bit otherwise
+#define FOLLOWING_ERROR     0x90 // encoder disagrees with steps, motor stalled
 #define CLEAR_ERROR         0xff // magic code to clear error
 
+// bad or lost host command, command is dropped and only the error is
+// shown, motor keeps doing what it was doing and stays homed
+#define errReportOnly(_e) ((_e) == CMD_DATA_ERROR || (_e) == OVERFLOW_ERROR)
+
 // state byte
 #define ERR_CODE            0x70
 #define AUX_RES_BIT         0x08 // do-d1 indicate what is in pos word
+#define ERR_EXT_BIT         AUX_RES_BIT // with ERR_CODE, code is 0x80 | eee
 #define BUSY_BIT            0x04
 #define MOTOR_ON_BIT        0x02
 #define HOMED_BIT           0x01
 
+// steps are planned ahead of the interrupt that outputs them
+#define STEP_Q_LEN    4     // must be power of 2
+#define STEP_DIR_BIT  0x04  // in stepQCtl, ustep is in d1-d0
+// interrupt matches bottom 16 bits of step time, a step due further
+// ahead than this is held in the event loop until it is in range
+#define STEP_HOLD_TICKS 32000
+
+// step segments from host, interrupt steps them without foreground planning
+// each segment is count steps, first step interval ticks after the previous
+// step and interval changes by add after each step
+#define SEG_Q_LEN 2  // must be power of 2, in moveQ (see move.h)
+
+struct stepSeg {
+  uint16 interval;
+  uint16 count;
+  int16  add;
+  uint8  ctl;     // ustep and dir, same as stepQCtl
+};
+
+// state the timer interrupt uses on every tick, kept apart from motorState
+// so the interrupt reads a few words per motor at small offsets
+// step queue is parallel arrays, an entry is found with a shift, not a multiply
+struct stepState {
+  uint16 stepQTicks[STEP_Q_LEN]; // when interrupt outputs step
+  uint8  stepQCtl[STEP_Q_LEN];   // ustep and dir for this step
+  uint8  stepQFire;       // idx of next step to output, only interrupt changes
+  uint8  stepQPlan;       // idx of next step to plan, only event loop changes
+  bool   segMode;         // stepping host segments, checkMotor not used
+  volatile uint8 segQHead;// idx of next seg to load, only interrupt changes
+  uint8  segQTail;        // idx of next free seg, only event loop changes
+  uint16 segTicks;        // time of next step (or last step when count 0)
+  struct stepSeg seg;     // seg being stepped, count is steps left
+};
+
+extern struct stepState sState[NUM_MOTORS];
+
+// byte fields are kept in pairs so no padding is added before 16-bit fields
 struct motorState {
   uint8  stateByte;
+  uint8  ustep;
   int16  targetPos;
   uint16 targetSpeed;
-  bool   targetDir;
-  bool   noBounds;
   int16  curPos;
   uint16 curSpeed;
-  bool   curDir;
   int16  backlashPos; // neg is left of dead zone, >= backlashWid is right
-  uint8  ustep;
   uint16 acceleration;
-  bool   stepPending;
-  bool   stepped;
-  bool   stopping;
-  bool   homing;
+  uint32 lastStepTicks;              // 32-bit time of last planned step
+  int16  stepQBacklash[STEP_Q_LEN];  // to undo step if cancelled before output
+  int8   stepQPosDelta[STEP_Q_LEN];  // change in curPos (after backlash)
   uint8  homingState;
-  bool   slowing;
   uint8  phase;  // bipolar: matches phase inside drv8825, unipolar: step phase
-  uint16 nextStepTicks;
-  uint16 lastStepTicks;
-  bool   haveCommand;
-  bool   resetAfterSoftStop;
-  bool   nextStateSpecialVal; // flag to return homeTestPos on next read
+  // flags only the event loop changes, interrupts never write these bits
+  uint8  targetDir          : 1;
+  uint8  noBounds           : 1;
+  uint8  curDir             : 1;
+  uint8  stopping           : 1;
+  uint8  homing             : 1;
+  uint8  slowing            : 1;
+  uint8  resetAfterSoftStop : 1;
+  uint8  homeRefValid       : 1;      // curPos still good after reset, see resetMotor
+  uint8  stepHeld           : 1;      // step in slot stepQPlan, not given to interrupt
+  uint8  homeDriftValid     : 1;      // curPos from last home, next home measures drift
+  uint8  haveLimSw          : 1;      // set when settings loaded
+  uint8  haveEnc            : 1;      // encoder enabled by settings
+  bool   haveCommand;                 // set in i2c interrupt
+  uint8  nextStateSpecialVal; // special value type + 1 to return on next read
   int16  homeTestPos;         // pos when limit sw closes
-  volatile uint16 *limitPort; // set when settings loaded
-  uint16 limitMask;           // set when settings loaded
-  uint16 limActThres;         // convenience from limit sw ctl setting
-  uint16 limActHyst;          // convenience from limit sw ctl setting
-  uint16 limitCntTimeout;     // num steps since pin chg (after hyst)
-  uint16 limitCountLo;        // num steps pin is low
-  uint16 limitCountHi;        // num steps pin is high
+  int16  driftLast;           // switch edge pos less edge pos of previous home
+  uint16 driftMax;            // largest drift (abs) since mcu reset
+  uint8  driftHomes;          // homes with drift measured, stops at 255
+  uint8  driftOverTol;        // of those, drift over driftTol setting
+  bool   limLevel;            // pin level at last change, set in interrupt
+  uint8  probeState;          // see probe states in move.h
+  uint16 limChgTicks;         // time of last pin change, set in interrupt
+  uint16 limEdgeTicks;        // time of last change after hyst, set in interrupt
+  int16  limEdgePos;          // curPos at limEdgeTicks, set in interrupt
+  int16  probePos;            // curPos when probe switch changed
+  uint8  encLast;             // AB levels at last change, set in interrupt
+  int32  encCount;            // counts since encRefPos, set in interrupt
+  int16  encRefPos;           // pos when encCount was 0
+  uint16 encErrMax;           // worst following error since last read
+  uint8  moveQHead;           // idx of next queued move in moveQ
+  uint8  moveQCount;          // num queued moves after current target
+  uint16 junctionDist;        // decel dist allowed at end of current move
 };
 
 extern struct motorState mState[NUM_MOTORS];
 
-#define haveError() (errorIntCode || (ms->stateByte & ERR_CODE))
+// steps planned and not yet output, _s is stepState
+#define stepsPlanned(_s) ((uint8) ((_s)->stepQPlan - (_s)->stepQFire))
+
+// host segments waiting or being stepped, _s is stepState
+#define segsActive(_s) ((_s)->seg.count || (_s)->segQHead != (_s)->segQTail)
+
+// full error code from state byte
+#define stateErrCode(_sb) \
+  (((_sb) & ERR_CODE) | (((_sb) & ERR_CODE) && ((_sb) & ERR_EXT_BIT) ? 0x80 : 0))
 
-extern volatile uint8 errorIntMot;
-extern volatile uint8 errorIntCode;
+// error that stopped the motor, report-only errors don't block stepping
+#define haveError() (errorIntCode[motorIdx] || ((ms->stateByte & ERR_CODE) && \
+                        !errReportOnly(stateErrCode(ms->stateByte))))
+
+// error mailbox per motor, set in interrupt and cleared by event loop
+extern volatile uint8 errorIntCode[NUM_MOTORS];
+
+// history of errors in order they happened, read with specialRead
+#define ERR_HIST_LEN 2  // must be power of 2
+struct errHistEntry {
+  uint16 ticks;
+  uint8  motIdx;
+  uint8  code;
+  int16  pos;
+  uint16 speed;
+};
+extern struct errHistEntry errHist[ERR_HIST_LEN];
+extern volatile uint8 errHistHead;  // oldest entry
+extern volatile uint8 errHistCount;
 
 void  setStateBit(uint8 mask, uint8 set);
 void  setError(uint8 err);
+void  errorState(uint8 err);
 void  setErrorInt(uint8 motorIdx, uint8 err);
 void  clrErrorInt(uint8 motorIdx);
 
@@ -8,16 +8,29 @@
 #include "clock.h"
 
 void stopStepping() {
-  ms->stepPending = false;
-  ms->stepped     = false;
+  cancelSteps();
   ms->homing      = false;
   ms->slowing     = false;
   ms->stopping    = false;
   ms->curSpeed    = 0;
+  ms->moveQCount  = 0;
+  disableAllInts;
+  ss->seg.count   = 0;
+  ss->segQHead    = ss->segQTail;
+  ss->segMode     = false;
+  // stopped probe is no longer armed, a result (hit or done) is kept for read
+  if(ms->probeState == PROBE_ARMED) ms->probeState = PROBE_MISSED;
+  enableAllInts;
   setStateBit(BUSY_BIT, 0);
 }
 
 void resetMotor() {
+  // motor that was homed and idle can keep its home when reset
+  // only if it will snap back less than a full step when turned on
+  uint8 phaseOfs = ms->phase & PHASE_CYCLE_MASK;
+  ms->homeRefValid = (sv->homeRetain && 
+                      (ms->stateByte & (BUSY_BIT | HOMED_BIT)) == HOMED_BIT &&
+                      (phaseOfs <= 8 || phaseOfs >= 32-8));
   setResetLo();
   stopStepping();
   setStateBit(MOTOR_ON_BIT, 0);
@@ -25,6 +38,12 @@ void resetMotor() {
 }
 
 void softStopCommand(bool resetAfter) {
+  if(ss->segMode) {
+    // host planned the segments, nothing to decelerate with
+    stopStepping();
+    if(resetAfter) resetMotor();
+    return;
+  }
   ms->slowing            = true;
   ms->homing             = false;
   ms->targetDir          = ms->curDir;
@@ -32,7 +51,7 @@ void softStopCommand(bool resetAfter) {
   ms->resetAfterSoftStop = resetAfter;
   if((ms->stateByte & BUSY_BIT) == 0) {
     disableAllInts;
-    ms->lastStepTicks = timeTicks;
+    ms->lastStepTicks = extTicksInt();
     enableAllInts;
     ms->curSpeed = sv->jerk; // triggers shutdown code
   }
@@ -0,0 +1,167 @@
+#include <xc.h>
+#include "types.h"
+#include "sync.h"
+#include "motor.h"
+#include "state.h"
+#include "clock.h"
+
+volatile bool   goPending;
+volatile uint32 goTicks;
+         bool   goStarting;
+         uint32 goStartTicks;
+
+struct heldCmd heldCmds[HELD_CMDS];
+uint8          timedCount;
+
+// cmd that can be held and started later
+// settings cmds read the i2c buffer, only moves make sense to hold anyway
+bool canHoldCmd(volatile uint8 *cmd, uint8 len) {
+  if(len > ARM_CMD_LEN || (len && (cmd[0] == 0x1e || cmd[0] == 0x1f || 
+                                   cmd[0] == 0x11 || cmd[0] == 0x1c))) {
+    setError(CMD_DATA_ERROR);
+    return false;
+  }
+  return true;
+}
+
+// cmd of motor armed for go, 0 when none
+struct heldCmd *armedCmd(uint8 motIdx) {
+  uint8 i;
+  for(i = 0; i < HELD_CMDS; i++) {
+    struct heldCmd *h = &heldCmds[i];
+    if(h->cmd[0] && h->motIdx == (motIdx | HELD_ARMED)) return h;
+  }
+  return 0;
+}
+
+// unused entry of pool, 0 and an error when all are held
+struct heldCmd *freeHeldCmd() {
+  uint8 i;
+  for(i = 0; i < HELD_CMDS; i++) {
+    if(heldCmds[i].cmd[0] == 0) return &heldCmds[i];
+  }
+  setError(OVERFLOW_ERROR);
+  return 0;
+}
+
+// copy cmd into held entry, entry is in use once length is set
+void holdCmd(struct heldCmd *h, uint8 motIdx, volatile uint8 *cmd, uint8 len) {
+  uint8 i;
+  h->motIdx = motIdx;
+  for(i = 0; i < len; i++) h->cmd[i + 1] = cmd[i];
+  h->cmd[0] = len;
+}
+
+// from event loop, cmd replaces any armed cmd, len 0 disarms
+void armCommand(volatile uint8 *cmd, uint8 len) {
+  if(!canHoldCmd(cmd, len)) return;
+  struct heldCmd *h = armedCmd(motorIdx);
+  if(len == 0) {
+    if(h) h->cmd[0] = 0;
+    return;
+  }
+  if(h == 0 && (h = freeHeldCmd()) == 0) return;
+  holdCmd(h, motorIdx | HELD_ARMED, cmd, len);
+}
+
+bool haveArmedCmds() {
+  uint8 i;
+  for(i = 0; i < HELD_CMDS; i++) {
+    if(heldCmds[i].cmd[0] && (heldCmds[i].motIdx & HELD_ARMED)) return true;
+  }
+  return false;
+}
+
+// from i2c interrupt, general call packet is done
+// stop bit reaches all mcus at once so each latches the same moment
+void genCallInt(volatile uint8 *bytes, uint8 len) {
+  if(len == 1 && bytes[0] == GEN_CALL_GO) {
+    goTicks   = extTicksNowInt();
+    goPending = true;
+    clkWakeStart();
+  }
+  else if(len == 5 && bytes[0] == GEN_CALL_SYNC) {
+    // time in packet is now, running moves are not disturbed
+    uint32 t = ((uint32) bytes[1] << 24) | ((uint32) bytes[2] << 16) |
+               ((uint16) bytes[3] <<  8) | bytes[4];
+    syncOfs = t - extTicksNowInt();
+  }
+}
+
+// from event loop, start all armed cmds from the same time
+void chkGo() {
+  if(!goPending) return;
+  disableAllInts;
+  goPending = false;
+  goStartTicks = goTicks + GO_START_TICKS;
+  enableAllInts;
+  goStarting = true;
+  for(motorIdx = 0; motorIdx < NUM_MOTORS; motorIdx++) {
+    struct heldCmd *h = armedCmd(motorIdx);
+    if(h) {
+      ms = &mState[motorIdx];
+      ss = &sState[motorIdx];
+      sv = &(mSet[motorIdx].val);
+      processCommand(h->cmd);
+      h->cmd[0] = 0;
+    }
+  }
+  goStarting = false;
+}
+
+// from event loop, cmd is started when synced time reaches ticks
+// len 0 clears all timed cmds of this motor
+void timedCommand(uint32 ticks, volatile uint8 *cmd, uint8 len) {
+  uint8 i;
+  if(len == 0) {
+    for(i = 0; i < HELD_CMDS; i++) {
+      struct heldCmd *t = &heldCmds[i];
+      if(t->cmd[0] && t->motIdx == motorIdx) {
+        t->cmd[0] = 0;
+        timedCount--;
+      }
+    }
+    return;
+  }
+  if(!canHoldCmd(cmd, len)) return;
+  if((int32) (ticks - syncTicks()) < 0) {
+    // host sent it too late to start on time
+    setError(STEP_NOT_DONE_ERROR);
+    return;
+  }
+  struct heldCmd *t = freeHeldCmd();
+  if(t == 0) return;
+  t->ticks = ticks;
+  holdCmd(t, motorIdx, cmd, len);
+  timedCount++;
+}
+
+// from event loop, start timed cmds that are due, earliest first
+// each starts from its own time, not from when this pass saw it
+void chkTimed() {
+  while(timedCount) {
+    uint32 now = syncTicks();
+    struct heldCmd *first = 0;
+    uint8 i;
+    for(i = 0; i < HELD_CMDS; i++) {
+      struct heldCmd *t = &heldCmds[i];
+      if(t->cmd[0] && !(t->motIdx & HELD_ARMED) &&
+         (int32) (t->ticks - now) <= 0 &&
+         (first == 0 || (int32) (t->ticks - first->ticks) < 0)) {
+        first = t;
+      }
+    }
+    if(first == 0) return;
+    motorIdx = first->motIdx;
+    ms = &mState[motorIdx];
+    ss = &sState[motorIdx];
+    sv = &(mSet[motorIdx].val);
+    // synced time back to this mcu's time
+    goStartTicks = first->ticks - syncOfs;
+    goStarting   = true;
+    processCommand(first->cmd);
+    goStarting   = false;
+    first->cmd[0] = 0;
+    timedCount--;
+  }
+}
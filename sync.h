@@ -0,0 +1,49 @@
+#ifndef SYNC_H
+#define	SYNC_H
+
+#include <xc.h>
+#include "types.h"
+#include "motor.h"
+
+// commands armed in each motor, started together by i2c general call "go"
+// go reaches all mcus on the bus at the same moment
+#define ARM_CMD_LEN     8   // longest cmd that can be armed (segment cmd)
+#define GEN_CALL_GO     0x01
+#define GEN_CALL_SYNC   0x02  // followed by 4-byte time, sets syncOfs
+#define GEN_CALL_MAX    5     // longest general call packet
+#define GO_START_TICKS  4   // armed moves start this long after go
+
+extern volatile bool   goPending;     // set in i2c interrupt
+extern volatile uint32 goTicks;       // 32-bit time go was received
+extern          bool   goStarting;    // armed or timed cmd being started
+extern          uint32 goStartTicks;
+
+// 32-bit time a move started now begins from
+// go start time when started by go, its own time when a timed cmd
+// with ints disabled
+#define moveStartTicks() (goStarting ? goStartTicks : extTicksInt())
+
+// timed cmds, each started when synced time (see GEN_CALL_SYNC) reaches
+// its time, and armed cmds wait in one pool for all motors of the mcu
+// an armed cmd is a held cmd with HELD_ARMED in motIdx and no time
+#define HELD_CMDS       4
+#define HELD_ARMED      0x80
+
+struct heldCmd {
+  uint32 ticks;                   // synced time to start, timed cmd only
+  uint8  motIdx;                  // with HELD_ARMED when armed for go
+  uint8  cmd[ARM_CMD_LEN + 1];    // first byte is length, 0 when free
+};
+extern struct heldCmd heldCmds[HELD_CMDS];
+extern uint8 timedCount;
+
+bool canHoldCmd(volatile uint8 *cmd, uint8 len);
+void armCommand(volatile uint8 *cmd, uint8 len);
+struct heldCmd *armedCmd(uint8 motIdx);
+bool haveArmedCmds(void);
+void genCallInt(volatile uint8 *bytes, uint8 len);
+void chkGo(void);
+void timedCommand(uint32 ticks, volatile uint8 *cmd, uint8 len);
+void chkTimed(void);
+
+#endif	/* SYNC_H */
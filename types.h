@@ -2,12 +2,23 @@
 #ifndef TYPES_H
 #define	TYPES_H
 
+#ifdef __XC16__
 typedef signed char int8;
 typedef unsigned char uint8;
 typedef int int16;
 typedef unsigned int uint16;
 typedef long int32;
 typedef unsigned long uint32;
+#else
+// host build (sim), same sizes as xc16 so wrapping math matches
+#include <stdint.h>
+typedef int8_t   int8;
+typedef uint8_t  uint8;
+typedef int16_t  int16;
+typedef uint16_t uint16;
+typedef int32_t  int32;
+typedef uint32_t uint32;
+#endif
 typedef char bool;
 
 #define true  1